@@ -19,6 +19,35 @@
 
 #include <idp.hpp>
 
+/**
+ * An item is one slot of a bundle, or the whole bundle with the
+ * TILEGX_BUNDLE_ITEMS option. The insn_t of an item has
+ * - the number of its slots in insnpref,
+ * - their itypes in auxpref, TILEGX_ITEM_ITYPE_BITS each,
+ * - in segpref the slot whose itype is the itype of the item, the one that
+ *   changes the control flow if there is one,
+ * - in specflag1 of every operand its slot.
+ */
+static const unsigned TILEGX_ITEM_ITYPE_BITS = 10;
+
+inline unsigned tilegx_item_slots(const insn_t& insn)
+{
+    return static_cast<unsigned>(insn.insnpref);
+}
+
+inline uint16_t tilegx_item_itype(const insn_t& insn, unsigned slot)
+{
+    return (insn.auxpref >> (TILEGX_ITEM_ITYPE_BITS * slot)) & ((1 << TILEGX_ITEM_ITYPE_BITS) - 1);
+}
+
 ssize_t tilegx_ana_insn(insn_t* cmd);
 
+/**
+ * Handlers for ev_is_call_insn and ev_is_ret_insn
+ *
+ * @return 1 if it is, -1 if it is not
+ */
+ssize_t tilegx_is_call_insn(const insn_t* insn);
+ssize_t tilegx_is_ret_insn(const insn_t* insn, bool strict);
+
 #endif /* _TILEGX_ANA_H */
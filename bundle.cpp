@@ -0,0 +1,144 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "bundle.hpp"
+#include "ins.hpp"
+#include "reg.hpp"
+
+/**
+ * Find the slots of the bundle, i.e. the instructions that are not padding.
+ * Instructions that cannot be bundled are padded with nops instead of fnops.
+ * If everything is padding, the last one is kept.
+ *
+ * @return Number of slots, 0 if an instruction cannot be decoded
+ */
+static unsigned find_slots(const TilegxOpcode* opcodes, unsigned num_instructions, unsigned slots[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE])
+{
+    TilegxOpcode padding_opcode = TILEGX_OPC_FNOP;
+    for (unsigned i = 0; i < num_instructions; ++i) {
+        if (opcodes[i] == TILEGX_OPC_NONE) {
+            return 0;
+        }
+        if (!tilegx_opcode_can_bundle(opcodes[i])) {
+            padding_opcode = TILEGX_OPC_NOP;
+        }
+    }
+
+    unsigned num_slots = 0;
+    for (unsigned i = 0; i < num_instructions; ++i) {
+        if (opcodes[i] == padding_opcode && (num_slots || i + 1 < num_instructions)) {
+            continue;
+        }
+        slots[num_slots++] = i;
+    }
+    return num_slots;
+}
+
+static TilegxSlot& add_slot(TilegxBundle& bundle, TilegxOpcode opcode, unsigned position)
+{
+    unsigned i = bundle.num_slots++;
+    TilegxSlot& slot = bundle.slots[i];
+    slot.itype = tilegx_opcode_itype(opcode);
+    bundle.positions |= position << (2 * i);
+
+    uint32_t feature = INSTRUCTIONS[slot.itype].feature;
+    if (feature & CF_CALL) {
+        bundle.flow |= TILEGX_FLOW_CALL;
+    }
+    if (feature & CF_JUMP) {
+        bundle.flow |= TILEGX_FLOW_JUMP;
+    }
+    if (feature & CF_STOP) {
+        bundle.flow |= TILEGX_FLOW_STOP;
+    }
+    return slot;
+}
+
+static void set_operands(TilegxSlot& slot, const TilegxInstruction& decoded_inst)
+{
+    slot.num_operands = decoded_inst.num_operands;
+    slot.operand_types = 0;
+    for (unsigned j = 0; j < decoded_inst.num_operands; ++j) {
+        TilegxOperandType type = decoded_inst.operands[j].type;
+        int64_t value = decoded_inst.operands[j].value;
+
+        //Special registers we know about are registers, the rest stays a number
+        if (type == TILEGX_OPERAND_SPR) {
+            const char* spr_name = tilegx_spr_name(static_cast<int>(value));
+            int reg = spr_name ? tilegx_find_register(spr_name) : -1;
+            if (reg >= 0) {
+                type = TILEGX_OPERAND_REGISTER;
+                value = reg;
+            }
+            else {
+                type = TILEGX_OPERAND_IMMEDIATE;
+            }
+        }
+
+        slot.operand_types |= type << (2 * j);
+        slot.values[j] = static_cast<int32_t>(value);
+    }
+}
+
+bool tilegx_build_bundle_opcodes(uint64_t bits, TilegxBundle& bundle)
+{
+    bundle = TilegxBundle();
+
+    TilegxOpcode opcodes[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    unsigned slots[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    unsigned num_slots = find_slots(opcodes, tilegx_decode_opcodes(bits, opcodes), slots);
+    for (unsigned i = 0; i < num_slots; ++i) {
+        add_slot(bundle, opcodes[slots[i]], slots[i]);
+    }
+
+    return num_slots != 0;
+}
+
+void tilegx_build_bundle_operands(uint64_t bits, TilegxBundle& bundle)
+{
+    //Addresses come out relative to the bundle with pc 0
+    for (unsigned i = 0; i < bundle.num_slots; ++i) {
+        TilegxInstruction decoded_inst;
+        decoded_inst.opcode = tilegx_itype_opcode(bundle.slots[i].itype);
+        tilegx_decode_operands(bits, 0, bundle.position(i), decoded_inst);
+        set_operands(bundle.slots[i], decoded_inst);
+    }
+    bundle.operands = true;
+}
+
+bool tilegx_build_bundle(uint64_t bits, TilegxBundle& bundle)
+{
+    bundle = TilegxBundle();
+
+    //Addresses come out relative to the bundle with pc 0
+    TilegxInstruction decoded[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    TilegxOpcode opcodes[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    unsigned num_instructions = tilegx_decode_bundle(bits, 0, decoded);
+    for (unsigned i = 0; i < num_instructions; ++i) {
+        opcodes[i] = decoded[i].opcode;
+    }
+
+    unsigned slots[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    unsigned num_slots = find_slots(opcodes, num_instructions, slots);
+    for (unsigned i = 0; i < num_slots; ++i) {
+        TilegxSlot& slot = add_slot(bundle, opcodes[slots[i]], slots[i]);
+        set_operands(slot, decoded[slots[i]]);
+    }
+
+    bundle.operands = num_slots != 0;
+    return num_slots != 0;
+}
@@ -0,0 +1,108 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_BUNDLE_HPP
+#define _TILEGX_BUNDLE_HPP
+
+#include <stdint.h>
+#include <type_traits>
+
+#include "dec.hpp"
+
+/**
+ * One IDA item of a bundle. Register operands hold the index into
+ * REGISTER_NAMES (special registers we know about included), addresses are
+ * relative to the bundle so that the record does not depend on where the
+ * bundle is.
+ */
+struct TilegxSlot
+{
+    uint16_t itype;
+    uint8_t num_operands;
+    uint8_t operand_types; //TilegxOperandType of operand i in bits [2i, 2i + 2)
+    int32_t values[TILEGX_MAX_OPERANDS];
+
+    TilegxOperandType operand_type(unsigned i) const {
+        return static_cast<TilegxOperandType>((operand_types >> (2 * i)) & 3);
+    }
+};
+
+/**
+ * Control flow of a bundle, the CF_CALL, CF_JUMP and CF_STOP features of
+ * its slots
+ */
+enum TilegxFlow : uint8_t
+{
+    TILEGX_FLOW_CALL = 1 << 0,
+    TILEGX_FLOW_JUMP = 1 << 1,
+    TILEGX_FLOW_STOP = 1 << 2
+};
+
+/**
+ * Decoded bundle, without padding slots. Fits one cache line and can be
+ * copied with memcpy.
+ *
+ * Bundles are decoded in two stages: the first one finds the itypes, slot
+ * count and control flow, the second one the operands. Records of the first
+ * stage only have has_operands() false and no operands.
+ */
+struct TilegxBundle
+{
+    TilegxSlot slots[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    uint8_t num_slots; //0 if the bundle cannot be decoded
+    uint8_t flow;      //TilegxFlow bits
+    uint8_t positions; //Index in the bundle of slot i in bits [2i, 2i + 2), for the second stage
+    bool operands;     //Second stage done
+
+    bool is_invalid() const {
+        return num_slots == 0;
+    }
+
+    bool has_operands() const {
+        return operands || num_slots == 0;
+    }
+
+    unsigned position(unsigned i) const {
+        return (positions >> (2 * i)) & 3;
+    }
+};
+
+static_assert(sizeof(TilegxBundle) == 64, "TilegxBundle should fit one cache line");
+static_assert(std::is_trivially_copyable< TilegxBundle >::value, "TilegxBundle must be trivially copyable");
+
+/**
+ * Decode a bundle into its record. Padding slots are dropped the same way
+ * libopcodes' printer drops them, so that the slot layout (and thus the IDA
+ * item layout) stays the same.
+ *
+ * @param bits Bundle, as little endian 64 bit word
+ * @param bundle Receives the record
+ * @return false if the bundle cannot be decoded
+ */
+bool tilegx_build_bundle(uint64_t bits, TilegxBundle& bundle);
+
+/**
+ * First stage of tilegx_build_bundle: only the itypes, slot count and
+ * control flow, which is all that is needed to tell code from data
+ */
+bool tilegx_build_bundle_opcodes(uint64_t bits, TilegxBundle& bundle);
+
+/**
+ * Second stage: add the operands to a first stage record of the same bundle
+ */
+void tilegx_build_bundle_operands(uint64_t bits, TilegxBundle& bundle);
+
+#endif /* _TILEGX_BUNDLE_HPP */
@@ -0,0 +1,691 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "cache.hpp"
+#include "ctx.hpp"
+#include "ins.hpp"
+#include "mem.hpp"
+
+//stdlib imports
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include <vector>
+
+//IDA Pro imports
+#include <netnode.hpp>
+#include <segment.hpp>
+
+namespace {
+
+const unsigned CHUNK_SHIFT = 9;
+const size_t CHUNK_BUNDLES = 1 << CHUNK_SHIFT;
+
+struct TilegxSegmentCache;
+
+struct TilegxCacheChunk
+{
+    TilegxSegmentCache* owner;
+    size_t index;    //Index in owner->chunks
+    bool referenced; //Reference bit for the CLOCK eviction
+    uint64_t present[CHUNK_BUNDLES / 64];
+    uint64_t prefetched[CHUNK_BUNDLES / 64]; //Decoded ahead and not used yet
+    TilegxBundle bundles[CHUNK_BUNDLES];
+};
+
+struct TilegxSegmentCache
+{
+    ea_t start_ea; //Address of the first bundle
+    ea_t end_ea;
+    bool dirty;    //Changed since it was saved to or loaded from the database
+    std::vector< std::unique_ptr< TilegxCacheChunk > > chunks;
+};
+
+/**
+ * Second level, direct mapped and keyed by the bundle word. Records are
+ * position independent, so identical bundles anywhere in the image share
+ * one decode. It counts against the budget and takes at most
+ * 1 / WORD_CACHE_SHARE of it.
+ */
+const unsigned MIN_WORD_CACHE_SHIFT = 10;
+const unsigned MAX_WORD_CACHE_SHIFT = 16;
+const size_t WORD_CACHE_SHARE = 8;
+
+struct TilegxWordCacheEntry
+{
+    uint64_t bits;
+    TilegxBundle bundle;
+};
+
+struct TilegxCacheState : TilegxContextPart
+{
+    //Sorted by start_ea
+    std::vector< std::unique_ptr< TilegxSegmentCache > > segment_caches;
+    TilegxSegmentCache* last_segment_cache = nullptr;
+
+    //All allocated chunks, in no particular order, and the hand of the clock
+    std::vector< TilegxCacheChunk* > clock_chunks;
+    size_t clock_hand = 0;
+
+    size_t budget = TILEGX_CACHE_DEFAULT_BUDGET;
+    size_t reserved = 0; //Bundles decoded outside of the cache, see tilegx_cache_reserve
+    TilegxCacheStats stats = {};
+
+    std::unique_ptr< TilegxWordCacheEntry[] > word_cache;
+    std::unique_ptr< uint64_t[] > word_cache_present;
+    unsigned word_cache_shift = 0;
+};
+
+TilegxCacheState& cache_state()
+{
+    std::unique_ptr< TilegxContextPart >& part = tilegx_context().cache;
+    if (!part) {
+        part.reset(new TilegxCacheState());
+    }
+    return static_cast<TilegxCacheState&>(*part);
+}
+
+void load_segment_cache(TilegxCacheState& state, TilegxSegmentCache* cache);
+
+TilegxSegmentCache* find_segment_cache(TilegxCacheState& state, ea_t ea, bool create)
+{
+    //Analysis stays in one segment most of the time
+    if (state.last_segment_cache && ea >= state.last_segment_cache->start_ea && ea < state.last_segment_cache->end_ea) {
+        return state.last_segment_cache;
+    }
+
+    auto itr = std::upper_bound(state.segment_caches.begin(), state.segment_caches.end(), ea,
+        [](ea_t addr, const std::unique_ptr< TilegxSegmentCache >& cache) {
+            return addr < cache->start_ea;
+        });
+    if (itr != state.segment_caches.begin() && ea < (*(itr - 1))->end_ea) {
+        state.last_segment_cache = (itr - 1)->get();
+        return state.last_segment_cache;
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+
+    segment_t* seg = getseg(ea);
+    if (seg == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr< TilegxSegmentCache > cache(new TilegxSegmentCache());
+    cache->start_ea = seg->start_ea & ~7;
+    cache->end_ea = seg->end_ea;
+
+    size_t num_bundles = (cache->end_ea - cache->start_ea + 7) >> 3;
+    cache->chunks.resize((num_bundles + CHUNK_BUNDLES - 1) >> CHUNK_SHIFT);
+
+    state.last_segment_cache = cache.get();
+    state.segment_caches.insert(itr, std::move(cache));
+    load_segment_cache(state, state.last_segment_cache);
+    return state.last_segment_cache;
+}
+
+void release_chunk(TilegxCacheState& state, size_t clock_idx)
+{
+    TilegxCacheChunk* chunk = state.clock_chunks[clock_idx];
+    state.clock_chunks[clock_idx] = state.clock_chunks.back();
+    state.clock_chunks.pop_back();
+
+    state.stats.resident_bytes -= sizeof(TilegxCacheChunk);
+    chunk->owner->chunks[chunk->index].reset();
+}
+
+/**
+ * Evict chunks until bytes more fit into the budget. Chunks that were used
+ * since the hand passed them last get a second chance.
+ */
+void make_room(TilegxCacheState& state, size_t bytes)
+{
+    while (state.budget && !state.clock_chunks.empty() && state.stats.resident_bytes + state.stats.snapshot_bytes + state.reserved + bytes > state.budget) {
+        if (state.clock_hand >= state.clock_chunks.size()) {
+            state.clock_hand = 0;
+        }
+
+        TilegxCacheChunk* chunk = state.clock_chunks[state.clock_hand];
+        if (chunk->referenced) {
+            chunk->referenced = false;
+            ++state.clock_hand;
+            continue;
+        }
+
+        release_chunk(state, state.clock_hand);
+        ++state.stats.evictions;
+    }
+}
+
+inline size_t word_cache_index(uint64_t bits, unsigned shift)
+{
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    return static_cast<size_t>(bits >> (64 - shift));
+}
+
+inline size_t word_cache_bytes(unsigned shift)
+{
+    size_t entries = static_cast<size_t>(1) << shift;
+    return entries * sizeof(TilegxWordCacheEntry) + entries / 64 * sizeof(uint64_t);
+}
+
+/**
+ * @return Largest word cache size that fits its share of the budget
+ */
+unsigned word_cache_shift(size_t budget)
+{
+    unsigned shift = MAX_WORD_CACHE_SHIFT;
+    while (budget && shift > MIN_WORD_CACHE_SHIFT && word_cache_bytes(shift) > budget / WORD_CACHE_SHARE) {
+        --shift;
+    }
+    return shift;
+}
+
+void free_word_cache(TilegxCacheState& state)
+{
+    if (state.word_cache) {
+        state.stats.resident_bytes -= word_cache_bytes(state.word_cache_shift);
+    }
+    state.word_cache.reset();
+    state.word_cache_present.reset();
+    state.word_cache_shift = 0;
+}
+
+/**
+ * Allocate the word cache if it is not there. Making room for it can evict
+ * any chunk, so this has to happen before a chunk is used, never while a
+ * record in one is being filled.
+ */
+void create_word_cache(TilegxCacheState& state)
+{
+    if (state.word_cache) {
+        return;
+    }
+
+    state.word_cache_shift = word_cache_shift(state.budget);
+    make_room(state, word_cache_bytes(state.word_cache_shift));
+
+    size_t entries = static_cast<size_t>(1) << state.word_cache_shift;
+    state.word_cache.reset(new TilegxWordCacheEntry[entries]);
+    state.word_cache_present.reset(new uint64_t[entries / 64]());
+    state.stats.resident_bytes += word_cache_bytes(state.word_cache_shift);
+}
+
+TilegxCacheChunk* allocate_chunk(TilegxCacheState& state, TilegxSegmentCache* cache, size_t chunk_idx)
+{
+    make_room(state, sizeof(TilegxCacheChunk));
+
+    std::unique_ptr< TilegxCacheChunk >& chunk = cache->chunks[chunk_idx];
+    chunk.reset(new TilegxCacheChunk());
+    chunk->owner = cache;
+    chunk->index = chunk_idx;
+    chunk->referenced = true; //Not filled yet, so it must not be the next to go
+    state.clock_chunks.push_back(chunk.get());
+    state.stats.resident_bytes += sizeof(TilegxCacheChunk);
+    return chunk.get();
+}
+
+void free_segment_cache(TilegxCacheState& state, size_t idx)
+{
+    TilegxSegmentCache* cache = state.segment_caches[idx].get();
+    for (size_t i = state.clock_chunks.size(); i-- > 0; ) {
+        if (state.clock_chunks[i]->owner == cache) {
+            release_chunk(state, i);
+        }
+    }
+
+    state.last_segment_cache = nullptr;
+    state.segment_caches.erase(state.segment_caches.begin() + idx);
+}
+
+/*
+ * Bundles are saved per segment in a blob of the netnode
+ * "$ tilegx bundles <segment start>": a TilegxSavedHeader, followed by the
+ * chunks that hold bundles, each as chunk index, occupancy bitmap and the
+ * records of the present bundles.
+ */
+const uint32_t SAVED_VERSION = 4;
+const uchar SAVED_BLOB_TAG = 'B';
+
+struct TilegxSavedHeader
+{
+    uint32_t version;
+    uint32_t layout;   //Changes with the record layout and the instruction tables
+    uint64_t start_ea;
+    uint64_t end_ea;
+    uint64_t checksum; //Of the segment bytes
+    uint32_t num_chunks;
+};
+
+uint32_t saved_layout()
+{
+    uint32_t layout = sizeof(TilegxBundle);
+    for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+        layout = layout * 31 + tilegx_opcode_itype(static_cast<TilegxOpcode>(opc));
+    }
+    return layout;
+}
+
+qstring saved_netnode_name(ea_t start_ea)
+{
+    qstring name;
+    name.sprnt("$ tilegx bundles %" FMT_EA "x", start_ea);
+    return name;
+}
+
+uint64_t segment_checksum(ea_t start_ea, ea_t end_ea)
+{
+    const TilegxSnapshot* snapshot = tilegx_snapshot(start_ea);
+    if (snapshot == nullptr) {
+        return 0;
+    }
+
+    size_t offset = start_ea - snapshot->start_ea;
+    size_t size = std::min(end_ea, snapshot->end_ea) - start_ea;
+
+    //FNV-1a over the bytes and which of them have a value
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = offset; i < offset + size; ++i) {
+        hash = (hash ^ snapshot->bytes[i]) * 0x100000001b3ULL;
+    }
+    for (size_t i = offset / TILEGX_BUNDLE_SIZE; i < (offset + size + 7) / TILEGX_BUNDLE_SIZE; ++i) {
+        hash = (hash ^ snapshot->mask[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void save_segment_cache(TilegxSegmentCache* cache)
+{
+    std::vector< uint8_t > blob(sizeof(TilegxSavedHeader));
+    uint32_t num_chunks = 0;
+
+    for (const std::unique_ptr< TilegxCacheChunk >& chunk : cache->chunks) {
+        if (!chunk) {
+            continue;
+        }
+
+        uint32_t index = static_cast<uint32_t>(chunk->index);
+        const uint8_t* index_bytes = reinterpret_cast<const uint8_t*>(&index);
+        const uint8_t* present_bytes = reinterpret_cast<const uint8_t*>(chunk->present);
+        blob.insert(blob.end(), index_bytes, index_bytes + sizeof(index));
+        blob.insert(blob.end(), present_bytes, present_bytes + sizeof(chunk->present));
+        for (size_t idx = 0; idx < CHUNK_BUNDLES; ++idx) {
+            if (chunk->present[idx / 64] & (1ULL << (idx % 64))) {
+                const uint8_t* bundle_bytes = reinterpret_cast<const uint8_t*>(&chunk->bundles[idx]);
+                blob.insert(blob.end(), bundle_bytes, bundle_bytes + sizeof(TilegxBundle));
+            }
+        }
+        ++num_chunks;
+    }
+
+    qstring name = saved_netnode_name(cache->start_ea);
+    if (num_chunks == 0) {
+        netnode node(name.c_str());
+        if (node != BADNODE) {
+            node.kill();
+        }
+        cache->dirty = false;
+        return;
+    }
+
+    TilegxSavedHeader header = {};
+    header.version = SAVED_VERSION;
+    header.layout = saved_layout();
+    header.start_ea = cache->start_ea;
+    header.end_ea = cache->end_ea;
+    header.checksum = segment_checksum(cache->start_ea, cache->end_ea);
+    header.num_chunks = num_chunks;
+    memcpy(blob.data(), &header, sizeof(header));
+
+    netnode node(name.c_str(), 0, true);
+    node.setblob(blob.data(), blob.size(), 0, SAVED_BLOB_TAG);
+    cache->dirty = false;
+}
+
+/**
+ * Fill a new table with the bundles saved in the database. Blobs that do
+ * not match this module or the current segment bytes are deleted.
+ */
+void load_segment_cache(TilegxCacheState& state, TilegxSegmentCache* cache)
+{
+    netnode node(saved_netnode_name(cache->start_ea).c_str());
+    if (node == BADNODE) {
+        return;
+    }
+
+    bytevec_t blob;
+    TilegxSavedHeader header;
+    if (node.getblob(&blob, 0, SAVED_BLOB_TAG) < static_cast<ssize_t>(sizeof(header))) {
+        node.kill();
+        return;
+    }
+
+    memcpy(&header, blob.begin(), sizeof(header));
+    if (header.version != SAVED_VERSION || header.layout != saved_layout() ||
+            header.start_ea != cache->start_ea || header.end_ea != cache->end_ea ||
+            header.checksum != segment_checksum(cache->start_ea, cache->end_ea)) {
+        node.kill();
+        return;
+    }
+
+    const uint8_t* pos = blob.begin() + sizeof(header);
+    const uint8_t* end = blob.end();
+    for (uint32_t i = 0; i < header.num_chunks; ++i) {
+        uint32_t index;
+        uint64_t present[CHUNK_BUNDLES / 64];
+        if (end - pos < static_cast<ptrdiff_t>(sizeof(index) + sizeof(present))) {
+            break;
+        }
+        memcpy(&index, pos, sizeof(index));
+        memcpy(present, pos + sizeof(index), sizeof(present));
+        pos += sizeof(index) + sizeof(present);
+
+        size_t num_present = 0;
+        for (uint64_t word : present) {
+            num_present += __builtin_popcountll(word);
+        }
+        if (index >= cache->chunks.size() || cache->chunks[index] ||
+                end - pos < static_cast<ptrdiff_t>(num_present * sizeof(TilegxBundle))) {
+            break;
+        }
+
+        TilegxCacheChunk* chunk = allocate_chunk(state, cache, index);
+        memcpy(chunk->present, present, sizeof(present));
+        for (size_t idx = 0; idx < CHUNK_BUNDLES; ++idx) {
+            if (present[idx / 64] & (1ULL << (idx % 64))) {
+                memcpy(&chunk->bundles[idx], pos, sizeof(TilegxBundle));
+                pos += sizeof(TilegxBundle);
+            }
+        }
+    }
+
+    cache->dirty = false;
+}
+
+} //namespace
+
+bool tilegx_cache_decode(uint64_t bits, TilegxBundle& bundle, bool operands)
+{
+    TilegxCacheState& state = cache_state();
+    create_word_cache(state);
+
+    size_t idx = word_cache_index(bits, state.word_cache_shift);
+    TilegxWordCacheEntry& entry = state.word_cache[idx];
+    uint64_t& present = state.word_cache_present[idx / 64];
+    if ((present & (1ULL << (idx % 64))) && entry.bits == bits) {
+        ++state.stats.word_hits;
+        bundle = entry.bundle;
+        return !bundle.is_invalid();
+    }
+
+    //Only complete records go into the word cache
+    if (!operands) {
+        return tilegx_build_bundle_opcodes(bits, bundle);
+    }
+
+    ++state.stats.word_misses;
+    bool valid = tilegx_build_bundle(bits, bundle);
+    entry.bits = bits;
+    entry.bundle = bundle;
+    present |= 1ULL << (idx % 64);
+    return valid;
+}
+
+TilegxBundle* tilegx_cache_find(ea_t bundle_ea)
+{
+    TilegxCacheState& state = cache_state();
+    create_word_cache(state);
+
+    //Creating the table loads the bundles saved in the database
+    TilegxSegmentCache* cache = find_segment_cache(state, bundle_ea, true);
+    if (cache == nullptr) {
+        ++state.stats.misses;
+        return nullptr;
+    }
+
+    size_t idx = (bundle_ea - cache->start_ea) >> 3;
+    TilegxCacheChunk* chunk = cache->chunks[idx >> CHUNK_SHIFT].get();
+    if (chunk == nullptr) {
+        ++state.stats.misses;
+        return nullptr;
+    }
+
+    idx &= CHUNK_BUNDLES - 1;
+    if ((chunk->present[idx / 64] & (1ULL << (idx % 64))) == 0) {
+        ++state.stats.misses;
+        return nullptr;
+    }
+
+    if (chunk->prefetched[idx / 64] & (1ULL << (idx % 64))) {
+        chunk->prefetched[idx / 64] &= ~(1ULL << (idx % 64));
+        ++state.stats.lookahead_hits;
+    }
+
+    ++state.stats.hits;
+    chunk->referenced = true;
+    return &chunk->bundles[idx];
+}
+
+TilegxBundle* tilegx_cache_insert(ea_t bundle_ea)
+{
+    TilegxCacheState& state = cache_state();
+    create_word_cache(state);
+
+    TilegxSegmentCache* cache = find_segment_cache(state, bundle_ea, true);
+    if (cache == nullptr) {
+        return nullptr;
+    }
+
+    size_t idx = (bundle_ea - cache->start_ea) >> 3;
+    TilegxCacheChunk* chunk = cache->chunks[idx >> CHUNK_SHIFT].get();
+    if (chunk == nullptr) {
+        chunk = allocate_chunk(state, cache, idx >> CHUNK_SHIFT);
+    }
+
+    cache->dirty = true;
+    idx &= CHUNK_BUNDLES - 1;
+    chunk->referenced = true;
+    chunk->present[idx / 64] |= 1ULL << (idx % 64);
+    chunk->prefetched[idx / 64] &= ~(1ULL << (idx % 64));
+    return &chunk->bundles[idx];
+}
+
+size_t tilegx_cache_lookahead(ea_t start_ea, size_t count)
+{
+    TilegxCacheState& state = cache_state();
+    //Decoding below must not evict the chunk it decodes into
+    create_word_cache(state);
+
+    TilegxSegmentCache* cache = find_segment_cache(state, start_ea, true);
+    const TilegxSnapshot* snapshot = tilegx_snapshot(start_ea);
+    if (cache == nullptr || snapshot == nullptr) {
+        return 0;
+    }
+
+    size_t first = (start_ea - cache->start_ea) >> 3;
+    size_t last = std::min(first + count, static_cast<size_t>((cache->end_ea - cache->start_ea + 7) >> 3));
+    size_t decoded = 0;
+    for (size_t idx = first; idx < last; ++idx) {
+        //Allocating can evict chunks, so look the chunk up every time
+        TilegxCacheChunk* chunk = cache->chunks[idx >> CHUNK_SHIFT].get();
+        if (chunk == nullptr) {
+            chunk = allocate_chunk(state, cache, idx >> CHUNK_SHIFT);
+        }
+
+        size_t chunk_idx = idx & (CHUNK_BUNDLES - 1);
+        uint64_t bit = 1ULL << (chunk_idx % 64);
+        if (chunk->present[chunk_idx / 64] & bit) {
+            continue;
+        }
+
+        uint64_t bits;
+        TilegxBundle& bundle = chunk->bundles[chunk_idx];
+        if (tilegx_snapshot_read(*snapshot, cache->start_ea + idx * TILEGX_BUNDLE_SIZE, bits)) {
+            tilegx_cache_decode(bits, bundle, false);
+        }
+        else {
+            bundle = TilegxBundle();
+        }
+        chunk->present[chunk_idx / 64] |= bit;
+        chunk->prefetched[chunk_idx / 64] |= bit;
+        ++decoded;
+    }
+
+    if (decoded) {
+        cache->dirty = true;
+    }
+    state.stats.lookahead_decoded += decoded;
+    return decoded;
+}
+
+bool tilegx_cache_contains(ea_t start_ea, size_t count)
+{
+    TilegxCacheState& state = cache_state();
+    TilegxSegmentCache* cache = find_segment_cache(state, start_ea, false);
+    if (cache == nullptr) {
+        return false;
+    }
+
+    size_t first = (start_ea - cache->start_ea) >> 3;
+    if (first + count > static_cast<size_t>((cache->end_ea - cache->start_ea + 7) >> 3)) {
+        return false;
+    }
+
+    for (size_t idx = first; idx < first + count; ++idx) {
+        const TilegxCacheChunk* chunk = cache->chunks[idx >> CHUNK_SHIFT].get();
+        size_t chunk_idx = idx & (CHUNK_BUNDLES - 1);
+        if (chunk == nullptr || (chunk->present[chunk_idx / 64] & (1ULL << (chunk_idx % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void tilegx_cache_invalidate(ea_t start_ea, ea_t end_ea)
+{
+    TilegxCacheState& state = cache_state();
+    for (size_t i = state.segment_caches.size(); i-- > 0; ) {
+        TilegxSegmentCache* cache = state.segment_caches[i].get();
+        if (cache->end_ea <= start_ea || cache->start_ea >= end_ea) {
+            continue;
+        }
+
+        if (start_ea <= cache->start_ea && end_ea >= cache->end_ea) {
+            free_segment_cache(state, i);
+            continue;
+        }
+
+        cache->dirty = true;
+        size_t first = ((std::max(start_ea, cache->start_ea) & ~7) - cache->start_ea) >> 3;
+        size_t last = (std::min(end_ea, cache->end_ea) - cache->start_ea + 7) >> 3;
+        for (size_t idx = first; idx < last; ++idx) {
+            TilegxCacheChunk* chunk = cache->chunks[idx >> CHUNK_SHIFT].get();
+            if (chunk == nullptr) {
+                //Nothing cached in this chunk, go to the next one
+                idx |= CHUNK_BUNDLES - 1;
+                continue;
+            }
+
+            size_t chunk_idx = idx & (CHUNK_BUNDLES - 1);
+            chunk->present[chunk_idx / 64] &= ~(1ULL << (chunk_idx % 64));
+            chunk->prefetched[chunk_idx / 64] &= ~(1ULL << (chunk_idx % 64));
+        }
+    }
+}
+
+void tilegx_cache_clear()
+{
+    TilegxCacheState& state = cache_state();
+    free_word_cache(state);
+    state.last_segment_cache = nullptr;
+    state.segment_caches.clear();
+    state.clock_chunks.clear();
+    state.clock_hand = 0;
+    state.stats.resident_bytes = 0;
+    state.reserved = 0;
+}
+
+void tilegx_cache_save()
+{
+    TilegxCacheState& state = cache_state();
+    for (const std::unique_ptr< TilegxSegmentCache >& cache : state.segment_caches) {
+        if (cache->dirty) {
+            save_segment_cache(cache.get());
+        }
+    }
+}
+
+void tilegx_cache_delete_saved(ea_t start_ea)
+{
+    netnode node(saved_netnode_name(start_ea & ~7).c_str());
+    if (node != BADNODE) {
+        node.kill();
+    }
+}
+
+void tilegx_cache_set_budget(size_t bytes)
+{
+    TilegxCacheState& state = cache_state();
+    state.budget = bytes;
+
+    //The word cache is sized for the budget, it is filled again on demand
+    if (state.word_cache && state.word_cache_shift != word_cache_shift(bytes)) {
+        free_word_cache(state);
+    }
+}
+
+size_t tilegx_cache_budget()
+{
+    return cache_state().budget;
+}
+
+size_t tilegx_cache_available()
+{
+    TilegxCacheState& state = cache_state();
+    size_t used = state.stats.resident_bytes + state.stats.snapshot_bytes + state.reserved;
+    return state.budget > used ? state.budget - used : 0;
+}
+
+void tilegx_cache_reserve(size_t bytes)
+{
+    cache_state().reserved += bytes;
+}
+
+void tilegx_cache_release(size_t bytes)
+{
+    TilegxCacheState& state = cache_state();
+    state.reserved -= std::min(bytes, state.reserved);
+}
+
+void tilegx_cache_add_snapshot(size_t bytes)
+{
+    cache_state().stats.snapshot_bytes += bytes;
+}
+
+void tilegx_cache_remove_snapshot(size_t bytes)
+{
+    TilegxCacheState& state = cache_state();
+    state.stats.snapshot_bytes -= std::min< uint64_t >(bytes, state.stats.snapshot_bytes);
+}
+
+const TilegxCacheStats& tilegx_cache_stats()
+{
+    return cache_state().stats;
+}
@@ -0,0 +1,154 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_CACHE_HPP
+#define _TILEGX_CACHE_HPP
+
+#include <idp.hpp>
+
+#include "bundle.hpp"
+
+/**
+ * Decoded bundles are cached per segment in a dense table indexed by
+ * (ea - segment start) >> 3. The table is split into chunks that are only
+ * allocated once a bundle in them is decoded, each chunk has an occupancy
+ * bitmap. Addresses outside of segments are not cached.
+ *
+ * The chunks are evicted with the CLOCK algorithm once they take more memory
+ * than the budget. Evicted bundles are simply decoded again. The segment
+ * snapshots the bundles are decoded from count against the same budget.
+ *
+ * Bundles can also be decoded ahead of use in one pass over the segment
+ * snapshot, see tilegx_cache_lookahead. Those records only hold the first
+ * decode stage until ana needs their operands.
+ *
+ * Below that is a cache keyed by the bundle word, which catches the many
+ * identical bundles (padding, prologues, epilogues) of an image. It saves
+ * their decoding, each address still holds its own copy of the record. Its
+ * size follows the budget and it counts against it.
+ *
+ * The tables are saved in the database and loaded when a segment is first
+ * used after opening it. Saved tables carry a checksum of the segment bytes
+ * and are dropped when the bytes changed.
+ */
+
+static const size_t TILEGX_CACHE_DEFAULT_BUDGET = 1024 * 1024 * 1024;
+
+struct TilegxCacheStats
+{
+    uint64_t resident_bytes; //Memory used by decoded bundles and the word cache
+    uint64_t snapshot_bytes; //Memory used by the segment snapshots, see mem.hpp
+    uint64_t evictions;      //Chunks evicted to stay within the budget
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t word_hits;      //Decodes saved because the same bundle word was decoded before
+    uint64_t word_misses;
+    uint64_t lookahead_decoded; //Bundles decoded ahead of use
+    uint64_t lookahead_hits;    //Bundles decoded ahead that were used later
+};
+
+/**
+ * Decode a bundle word through the word cache, see tilegx_build_bundle
+ *
+ * @param operands false if the first decode stage is enough. The record
+ *                 still has the operands if the word cache has them.
+ */
+bool tilegx_cache_decode(uint64_t bits, TilegxBundle& bundle, bool operands);
+
+/**
+ * @return Cached record of the bundle at bundle_ea, or nullptr if it has not
+ *         been decoded yet. The record can lack the operands, see
+ *         tilegx_build_bundle_operands.
+ */
+TilegxBundle* tilegx_cache_find(ea_t bundle_ea);
+
+/**
+ * Mark the bundle at bundle_ea as cached. The caller fills in the record.
+ * This can evict other bundles, records returned earlier are invalid after
+ * this call.
+ *
+ * @return Record to fill, or nullptr if bundle_ea is not in a segment
+ */
+TilegxBundle* tilegx_cache_insert(ea_t bundle_ea);
+
+/**
+ * Decode the bundles in [start_ea, start_ea + count * 8) that are not cached
+ * yet, in one pass over the segment snapshot. Only the first decode stage
+ * is done, the operands follow when the bundle is analyzed. Stops at the end
+ * of the segment. Records returned earlier are invalid after this call.
+ *
+ * @return Number of bundles decoded
+ */
+size_t tilegx_cache_lookahead(ea_t start_ea, size_t count);
+
+/**
+ * @return Whether all bundles in [start_ea, start_ea + count * 8) are cached.
+ *         Does not count as a lookup.
+ */
+bool tilegx_cache_contains(ea_t start_ea, size_t count);
+
+/**
+ * Forget all cached bundles that overlap [start_ea, end_ea). Tables of
+ * segments that are completely in the range are freed.
+ */
+void tilegx_cache_invalidate(ea_t start_ea, ea_t end_ea);
+
+/**
+ * Free all tables
+ */
+void tilegx_cache_clear();
+
+/**
+ * Save the tables that changed since they were loaded or saved to the
+ * database
+ */
+void tilegx_cache_save();
+
+/**
+ * Delete the table saved for the segment that started at start_ea
+ */
+void tilegx_cache_delete_saved(ea_t start_ea);
+
+/**
+ * Set the memory budget in bytes, 0 for no limit. It applies to the next
+ * insertion.
+ */
+void tilegx_cache_set_budget(size_t bytes);
+size_t tilegx_cache_budget();
+
+/**
+ * @return Bytes left in the budget, 0 if there is no limit
+ */
+size_t tilegx_cache_available();
+
+/**
+ * Count bytes of bundles decoded outside of the cache (by the pre-decoders)
+ * against the budget until they are released, usually right before they
+ * are inserted
+ */
+void tilegx_cache_reserve(size_t bytes);
+void tilegx_cache_release(size_t bytes);
+
+/**
+ * Count the segment snapshots against the budget. They cannot be evicted,
+ * so the decoded bundles make room for them on the next insertion.
+ */
+void tilegx_cache_add_snapshot(size_t bytes);
+void tilegx_cache_remove_snapshot(size_t bytes);
+
+const TilegxCacheStats& tilegx_cache_stats();
+
+#endif /* _TILEGX_CACHE_HPP */
@@ -0,0 +1,43 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "ctx.hpp"
+
+static std::unique_ptr< TilegxContext > current;
+
+TilegxContext::TilegxContext() :
+    options(TILEGX_DEFAULT_OPTIONS),
+    processor(TILEGX_PROCESSOR_TILEGX),
+    lookahead_ea(BADADDR),
+    lookahead_window(0)
+{
+}
+
+TilegxContext& tilegx_context()
+{
+    return *current;
+}
+
+void tilegx_create_context()
+{
+    current.reset(new TilegxContext());
+}
+
+void tilegx_destroy_context()
+{
+    current.reset();
+}
@@ -0,0 +1,69 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_CTX_HPP
+#define _TILEGX_CTX_HPP
+
+#include <idp.hpp>
+
+#include <memory>
+
+#include "opt.hpp"
+#include "reg.hpp"
+
+/**
+ * All mutable state of the module belongs to one context, which lives from
+ * ev_init to ev_term, i.e. as long as the module is loaded. The module can
+ * stay loaded when a database is closed and the next one opened, so the
+ * state of the database is cleared on closebase (see idb.cpp). Nothing
+ * leaks from one database into the next, and the decoder itself
+ * (tilegx_decode_bundle, tilegx_build_bundle) has no state at all.
+ *
+ * The parts of the module keep their private state in a TilegxContextPart,
+ * created on first use.
+ */
+struct TilegxContextPart
+{
+    virtual ~TilegxContextPart() {}
+};
+
+struct TilegxContext
+{
+    TilegxOptions options;
+    TilegxProcessor processor; //Set on ev_newprc
+
+    //Analysis, see ana.cpp
+    ea_t lookahead_ea;       //Cache miss that continues the last one sequentially
+    size_t lookahead_window;
+
+    std::unique_ptr< TilegxContextPart > snapshots;  //mem.cpp
+    std::unique_ptr< TilegxContextPart > cache;      //cache.cpp
+    std::unique_ptr< TilegxContextPart > flow;       //scan.cpp
+    std::unique_ptr< TilegxContextPart > diagnostics; //diag.cpp
+    std::unique_ptr< TilegxContextPart > background; //pre.cpp, reads the snapshots so it goes first
+
+    TilegxContext();
+};
+
+/**
+ * @return Context of the current database
+ */
+TilegxContext& tilegx_context();
+
+void tilegx_create_context();
+void tilegx_destroy_context();
+
+#endif /* _TILEGX_CTX_HPP */
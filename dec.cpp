@@ -0,0 +1,214 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "dec.hpp"
+
+//stdlib imports
+#include <algorithm>
+
+namespace {
+
+struct TilegxOperandSegment
+{
+    uint8_t src_shift;
+    uint8_t width;
+    uint8_t dst_shift;
+};
+
+struct TilegxOperandDesc
+{
+    TilegxOperandType type;
+    uint8_t num_bits;
+    bool is_signed;
+    uint8_t num_segments;
+    TilegxOperandSegment segments[2];
+};
+
+struct TilegxOpcodeDesc
+{
+    uint8_t pipes;
+    uint8_t num_operands;
+    bool can_bundle;
+    int8_t operands[5][TILEGX_MAX_OPERANDS];
+};
+
+/**
+ * Node of the decode tree of a pipeline. Internal nodes select one of their
+ * 2^width children with the bundle bits at [shift, shift + width), leaves
+ * hold count candidates that are checked in order.
+ */
+struct TilegxDecodeNode
+{
+    uint16_t index;
+    uint8_t shift;
+    uint8_t width;
+    uint8_t count;
+};
+
+struct TilegxDecodeCandidate
+{
+    uint64_t mask;
+    uint64_t value;
+    TilegxOpcode opcode;
+};
+
+struct TilegxEncoding
+{
+    uint64_t mask;
+    uint64_t value;
+};
+
+struct TilegxSpr
+{
+    int number;
+    const char* name;
+};
+
+//Tables generated by gentables
+#include "tables.inc"
+
+const uint64_t BUNDLE_MODE_MASK = 3ULL << 62;
+
+template< TilegxPipeline Pipe >
+inline TilegxOpcode find_opcode(uint64_t bits)
+{
+    const TilegxDecodeNode* node = &TILEGX_DECODE_NODES[TILEGX_DECODE_ROOTS[Pipe]];
+
+    while (node->width) {
+        node = &TILEGX_DECODE_NODES[node->index + ((bits >> node->shift) & ((1u << node->width) - 1))];
+    }
+
+    const TilegxDecodeCandidate* cand = &TILEGX_DECODE_CANDIDATES[node->index];
+    for (const TilegxDecodeCandidate* end = cand + node->count; cand != end; ++cand) {
+        if ((bits & cand->mask) == cand->value) {
+            return cand->opcode;
+        }
+    }
+
+    return TILEGX_OPC_NONE;
+}
+
+inline int64_t extract_operand(uint64_t bits, uint64_t pc, const TilegxOperandDesc& desc)
+{
+    uint64_t raw = 0;
+    for (unsigned i = 0; i < desc.num_segments; ++i) {
+        const TilegxOperandSegment& seg = desc.segments[i];
+        raw |= ((bits >> seg.src_shift) & ((1ULL << seg.width) - 1)) << seg.dst_shift;
+    }
+
+    int64_t value = static_cast<int64_t>(raw);
+    if (desc.is_signed) {
+        int64_t sign = 1LL << (desc.num_bits - 1);
+        value = (value ^ sign) - sign;
+    }
+
+    //Branch offsets are in bundles, relative to the bundle address
+    if (desc.type == TILEGX_OPERAND_ADDRESS) {
+        value = value * TILEGX_BUNDLE_SIZE + pc;
+    }
+
+    return value;
+}
+
+inline void decode_operands(uint64_t bits, uint64_t pc, unsigned pipe, TilegxInstruction& inst)
+{
+    const TilegxOpcodeDesc& desc = TILEGX_OPCODE_DESCS[inst.opcode];
+    inst.num_operands = desc.num_operands;
+    for (unsigned i = 0; i < desc.num_operands; ++i) {
+        const TilegxOperandDesc& op = TILEGX_OPERAND_DESCS[desc.operands[pipe][i]];
+        inst.operands[i].type = op.type;
+        inst.operands[i].value = extract_operand(bits, pc, op);
+    }
+}
+
+template< TilegxPipeline Pipe >
+inline void decode_slot(uint64_t bits, uint64_t pc, TilegxInstruction& inst)
+{
+    inst.opcode = find_opcode< Pipe >(bits);
+    decode_operands(bits, pc, Pipe, inst);
+}
+
+} //namespace
+
+unsigned tilegx_decode_bundle(uint64_t bits, uint64_t pc, TilegxInstruction insts[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE])
+{
+    if ((bits & BUNDLE_MODE_MASK) == 0) {
+        decode_slot< TILEGX_PIPELINE_X0 >(bits, pc, insts[0]);
+        decode_slot< TILEGX_PIPELINE_X1 >(bits, pc, insts[1]);
+        return 2;
+    }
+
+    decode_slot< TILEGX_PIPELINE_Y0 >(bits, pc, insts[0]);
+    decode_slot< TILEGX_PIPELINE_Y1 >(bits, pc, insts[1]);
+    decode_slot< TILEGX_PIPELINE_Y2 >(bits, pc, insts[2]);
+    return 3;
+}
+
+unsigned tilegx_decode_opcodes(uint64_t bits, TilegxOpcode opcodes[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE])
+{
+    if ((bits & BUNDLE_MODE_MASK) == 0) {
+        opcodes[0] = find_opcode< TILEGX_PIPELINE_X0 >(bits);
+        opcodes[1] = find_opcode< TILEGX_PIPELINE_X1 >(bits);
+        return 2;
+    }
+
+    opcodes[0] = find_opcode< TILEGX_PIPELINE_Y0 >(bits);
+    opcodes[1] = find_opcode< TILEGX_PIPELINE_Y1 >(bits);
+    opcodes[2] = find_opcode< TILEGX_PIPELINE_Y2 >(bits);
+    return 3;
+}
+
+void tilegx_decode_operands(uint64_t bits, uint64_t pc, unsigned index, TilegxInstruction& inst)
+{
+    unsigned first_pipe = (bits & BUNDLE_MODE_MASK) == 0 ? TILEGX_PIPELINE_X0 : TILEGX_PIPELINE_Y0;
+    decode_operands(bits, pc, first_pipe + index, inst);
+}
+
+const char* tilegx_opcode_name(TilegxOpcode opcode)
+{
+    return TILEGX_OPCODE_NAMES[opcode];
+}
+
+bool tilegx_opcode_can_bundle(TilegxOpcode opcode)
+{
+    return TILEGX_OPCODE_DESCS[opcode].can_bundle;
+}
+
+bool tilegx_opcode_encoding(TilegxOpcode opcode, TilegxPipeline pipe, uint64_t& mask, uint64_t& value)
+{
+    if (!(TILEGX_OPCODE_DESCS[opcode].pipes & (1 << pipe))) {
+        return false;
+    }
+
+    mask = TILEGX_OPCODE_ENCODINGS[opcode][pipe].mask;
+    value = TILEGX_OPCODE_ENCODINGS[opcode][pipe].value;
+    return true;
+}
+
+const char* tilegx_spr_name(int number)
+{
+    const TilegxSpr* begin = TILEGX_SPRS;
+    const TilegxSpr* end = TILEGX_SPRS + sizeof(TILEGX_SPRS) / sizeof(TILEGX_SPRS[0]);
+    const TilegxSpr* itr = std::lower_bound(begin, end, number, [](const TilegxSpr& spr, int num) {
+        return spr.number < num;
+    });
+
+    if (itr != end && itr->number == number) {
+        return itr->name;
+    }
+    return nullptr;
+}
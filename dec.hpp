@@ -0,0 +1,104 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_DEC_HPP
+#define _TILEGX_DEC_HPP
+
+#include <stdint.h>
+
+//TilegxOpcode and TILEGX_OPCODE_NAMES, generated by gentables
+#include "opcodes.inc"
+
+static const unsigned TILEGX_BUNDLE_SIZE = 8;
+static const unsigned TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE = 3;
+static const unsigned TILEGX_MAX_OPERANDS = 4;
+
+enum TilegxPipeline
+{
+    TILEGX_PIPELINE_X0,
+    TILEGX_PIPELINE_X1,
+    TILEGX_PIPELINE_Y0,
+    TILEGX_PIPELINE_Y1,
+    TILEGX_PIPELINE_Y2
+};
+
+enum TilegxOperandType : uint8_t
+{
+    TILEGX_OPERAND_REGISTER,
+    TILEGX_OPERAND_IMMEDIATE,
+    TILEGX_OPERAND_ADDRESS,
+    TILEGX_OPERAND_SPR
+};
+
+struct TilegxOperand
+{
+    TilegxOperandType type;
+    int64_t value; //Register or SPR number, immediate, or absolute address
+};
+
+struct TilegxInstruction
+{
+    TilegxOpcode opcode;
+    uint8_t num_operands;
+    TilegxOperand operands[TILEGX_MAX_OPERANDS];
+};
+
+/**
+ * Decode all instructions of a bundle, like libopcodes' parse_insn_tilegx.
+ * The decoder is table driven and has no state, so it is safe to call from
+ * any thread.
+ *
+ * @param bits Bundle, as little endian 64 bit word
+ * @param pc Address of the bundle, used for branch targets
+ * @param insts Receives one instruction per pipeline, in pipeline order.
+ *              Invalid slots have the opcode TILEGX_OPC_NONE.
+ * @return Number of instructions in the bundle (2 for X, 3 for Y mode)
+ */
+unsigned tilegx_decode_bundle(uint64_t bits, uint64_t pc, TilegxInstruction insts[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE]);
+
+/**
+ * Like tilegx_decode_bundle, but only finds the opcodes and leaves the
+ * operands alone
+ */
+unsigned tilegx_decode_opcodes(uint64_t bits, TilegxOpcode opcodes[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE]);
+
+/**
+ * The rest of tilegx_decode_bundle for one instruction of which the opcode
+ * is known, e.g. from tilegx_decode_opcodes
+ *
+ * @param index Index of the instruction in the bundle, as in tilegx_decode_opcodes
+ * @param inst Has the opcode set, receives the operands
+ */
+void tilegx_decode_operands(uint64_t bits, uint64_t pc, unsigned index, TilegxInstruction& inst);
+
+const char* tilegx_opcode_name(TilegxOpcode opcode);
+bool tilegx_opcode_can_bundle(TilegxOpcode opcode);
+
+/**
+ * Get the fixed bits of the opcode in a pipeline: bundles with
+ * (bits & mask) == value have it in that pipeline, provided the bundle mode
+ * (X or Y) matches.
+ *
+ * @return false if the opcode is not available in the pipeline
+ */
+bool tilegx_opcode_encoding(TilegxOpcode opcode, TilegxPipeline pipe, uint64_t& mask, uint64_t& value);
+
+/**
+ * @return Name of the special purpose register, or nullptr if it is unknown
+ */
+const char* tilegx_spr_name(int number);
+
+#endif /* _TILEGX_DEC_HPP */
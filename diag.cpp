@@ -0,0 +1,202 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "diag.hpp"
+#include "ctx.hpp"
+
+//stdlib imports
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+
+//IDA Pro imports
+#include <kernwin.hpp>
+
+//Diagnostics are counted per range of this many bytes
+static const ea_t DIAG_RANGE_SIZE = 0x10000;
+
+//Least time between two summaries
+static const int DIAG_SUMMARY_SECONDS = 10;
+
+static const char* const DIAG_NAMES[TILEGX_NUM_DIAGNOSTICS] = {
+    "undecodable bundles",
+    "unknown registers",
+    "code addresses outside of jumps and calls",
+};
+
+static const char DIAG_ACTION_NAME[] = "tilegx:diagnostics";
+
+namespace {
+
+struct TilegxDiagCount
+{
+    uint64_t count;
+    ea_t first_ea;
+};
+
+struct TilegxDiagRange
+{
+    TilegxDiagCount counts[TILEGX_NUM_DIAGNOSTICS];
+};
+
+struct TilegxDiagState : TilegxContextPart
+{
+    //Keyed by the start of the range
+    std::map< ea_t, TilegxDiagRange > ranges;
+    TilegxDiagCount pending[TILEGX_NUM_DIAGNOSTICS] = {};
+    uint64_t num_pending = 0;
+    ea_t last_ea[TILEGX_NUM_DIAGNOSTICS];
+    std::chrono::steady_clock::time_point last_summary;
+
+    TilegxDiagState()
+    {
+        std::fill(std::begin(last_ea), std::end(last_ea), BADADDR);
+    }
+};
+
+TilegxDiagState& diag_state()
+{
+    std::unique_ptr< TilegxContextPart >& part = tilegx_context().diagnostics;
+    if (!part) {
+        part.reset(new TilegxDiagState());
+    }
+    return static_cast<TilegxDiagState&>(*part);
+}
+
+void add_count(TilegxDiagCount& count, ea_t ea)
+{
+    if (count.count == 0 || ea < count.first_ea) {
+        count.first_ea = ea;
+    }
+    ++count.count;
+}
+
+struct TilegxDiagActionHandler : action_handler_t
+{
+    int idaapi activate(action_activation_ctx_t*) override
+    {
+        tilegx_diag_report();
+        return 0;
+    }
+
+    action_state_t idaapi update(action_update_ctx_t*) override
+    {
+        return AST_ENABLE_ALWAYS;
+    }
+};
+
+TilegxDiagActionHandler diag_action_handler;
+
+} //namespace
+
+void tilegx_diag(TilegxDiagnostic diag, ea_t ea)
+{
+    //IDA analyzes the same address several times in a row
+    TilegxDiagState& state = diag_state();
+    if (state.last_ea[diag] == ea) {
+        return;
+    }
+    state.last_ea[diag] = ea;
+
+    add_count(state.ranges[ea - ea % DIAG_RANGE_SIZE].counts[diag], ea);
+    add_count(state.pending[diag], ea);
+    ++state.num_pending;
+
+    //Checking the clock is cheap next to the analysis that found the problem
+    auto now = std::chrono::steady_clock::now();
+    if (now - state.last_summary >= std::chrono::seconds(DIAG_SUMMARY_SECONDS)) {
+        tilegx_diag_flush();
+    }
+}
+
+void tilegx_diag_flush()
+{
+    TilegxDiagState& state = diag_state();
+    if (state.num_pending == 0) {
+        return;
+    }
+
+    msg("Tile-GX: %" FMT_64 "u new diagnostics:", state.num_pending);
+    for (unsigned diag = 0; diag < TILEGX_NUM_DIAGNOSTICS; ++diag) {
+        const TilegxDiagCount& pending = state.pending[diag];
+        if (pending.count) {
+            msg(" %" FMT_64 "u %s (first at 0x%" FMT_EA "x)", pending.count, DIAG_NAMES[diag], pending.first_ea);
+        }
+    }
+    msg(". Edit/Other/Tile-GX diagnostics shows all of them.\n");
+
+    for (TilegxDiagCount& pending : state.pending) {
+        pending = TilegxDiagCount();
+    }
+    state.num_pending = 0;
+    state.last_summary = std::chrono::steady_clock::now();
+}
+
+void tilegx_diag_report()
+{
+    TilegxDiagState& state = diag_state();
+    if (state.ranges.empty()) {
+        msg("Tile-GX: no diagnostics\n");
+        return;
+    }
+
+    for (unsigned diag = 0; diag < TILEGX_NUM_DIAGNOSTICS; ++diag) {
+        uint64_t total = 0;
+        for (const auto& range : state.ranges) {
+            total += range.second.counts[diag].count;
+        }
+        if (total == 0) {
+            continue;
+        }
+
+        msg("Tile-GX: %" FMT_64 "u %s\n", total, DIAG_NAMES[diag]);
+        for (const auto& range : state.ranges) {
+            const TilegxDiagCount& count = range.second.counts[diag];
+            if (count.count) {
+                msg("    0x%" FMT_EA "x-0x%" FMT_EA "x: %" FMT_64 "u, first at 0x%" FMT_EA "x\n",
+                    range.first, range.first + DIAG_RANGE_SIZE, count.count, count.first_ea);
+            }
+        }
+    }
+
+    //Everything has been shown now
+    for (TilegxDiagCount& pending : state.pending) {
+        pending = TilegxDiagCount();
+    }
+    state.num_pending = 0;
+}
+
+void tilegx_diag_clear()
+{
+    tilegx_context().diagnostics.reset();
+}
+
+void tilegx_register_diag_action()
+{
+    const action_desc_t desc = ACTION_DESC_LITERAL(DIAG_ACTION_NAME, "Tile-GX diagnostics", &diag_action_handler,
+                                                   nullptr, "Show the diagnostics of the Tile-GX analysis", -1);
+    if (register_action(desc)) {
+        attach_action_to_menu("Edit/Other/", DIAG_ACTION_NAME, SETMENU_APP);
+    }
+}
+
+void tilegx_unregister_diag_action()
+{
+    detach_action_from_menu("Edit/Other/", DIAG_ACTION_NAME);
+    unregister_action(DIAG_ACTION_NAME);
+}
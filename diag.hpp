@@ -0,0 +1,62 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_DIAG_HPP
+#define _TILEGX_DIAG_HPP
+
+#include <idp.hpp>
+
+/**
+ * Diagnostics of the analysis are counted, per kind and per address range,
+ * instead of being written to the output window one by one. A summary of
+ * the new ones is written at most every DIAG_SUMMARY_SECONDS and when the
+ * analysis queues run empty, the full report through the
+ * "Tile-GX diagnostics" action (Edit/Other). The same address reported
+ * again right away counts once.
+ */
+enum TilegxDiagnostic
+{
+    TILEGX_DIAG_UNDECODABLE,      //Bundle that does not decode
+    TILEGX_DIAG_UNKNOWN_REGISTER, //Register operand out of range
+    TILEGX_DIAG_UNEXPECTED_NEAR,  //Code address in an instruction that neither jumps nor calls
+    TILEGX_NUM_DIAGNOSTICS
+};
+
+/**
+ * Count a diagnostic at ea
+ */
+void tilegx_diag(TilegxDiagnostic diag, ea_t ea);
+
+/**
+ * Write a summary of the diagnostics counted since the last one, if there
+ * are any
+ */
+void tilegx_diag_flush();
+
+/**
+ * Write all diagnostics counted for the database
+ */
+void tilegx_diag_report();
+
+/**
+ * Forget all diagnostics, for the next database
+ */
+void tilegx_diag_clear();
+
+void tilegx_register_diag_action();
+void tilegx_unregister_diag_action();
+
+#endif /* _TILEGX_DIAG_HPP */
@@ -17,35 +17,407 @@
 #include "emu.hpp"
 #include "log.hpp"
 #include "ins.hpp"
+#include "diag.hpp"
+#include "ana.hpp"
+#include "dec.hpp"
+#include "reg.hpp"
+#include "scan.hpp"
 
-ssize_t tilegx_emu_insn(const insn_t* cmd)
+//stdlib imports
+#include <algorithm>
+#include <string.h>
+
+//IDA Pro imports
+#include <bytes.hpp>
+#include <frame.hpp>
+#include <funcs.hpp>
+#include <netnode.hpp>
+
+//Items searched back through the basic block for the instruction that set
+//a frame register
+static const int MAX_FRAME_SEARCH = 64;
+
+static const uint32_t CHG_FLAGS[] = { CF_CHG1, CF_CHG2, CF_CHG3, CF_CHG4, CF_CHG5, CF_CHG6 };
+
+/**
+ * Code references of the control flow slots of item, from the last item of
+ * the bundle
+ *
+ * @param stop Set if a slot does not continue with the next bundle
+ */
+static void add_flow_refs(const insn_t* cmd, const insn_t& item, bool& stop)
 {
-    log("emu(%08" FMT_EA "x), itype=%d\n", cmd->ea, cmd->itype);
+    for (unsigned slot = 0; slot < tilegx_item_slots(item); ++slot) {
+        if (INSTRUCTIONS[tilegx_item_itype(item, slot)].feature & CF_STOP) {
+            stop = true;
+        }
+    }
+
+    for (const op_t& op : item.ops) {
+        if (op.type != o_near) {
+            continue;
+        }
+        log("adding cref\n");
+
+        uint16_t itype = tilegx_item_itype(item, op.specflag1);
+        if (tilegx_itype_is(itype, TILEGX_CLASS_CALL)) {
+            cmd->add_cref(op.addr, 0, fl_CN);
+        }
+        else if (tilegx_itype_is(itype, TILEGX_CLASS_COND_BRANCH | TILEGX_CLASS_DIRECT_JUMP)) {
+            cmd->add_cref(op.addr, 0, fl_JN);
+        }
+        else {
+            tilegx_diag(TILEGX_DIAG_UNEXPECTED_NEAR, item.ea);
+        }
+    }
+}
+
+/**
+ * @return Number of operands of the slot of item, stored in ops
+ */
+static unsigned slot_operands(const insn_t& item, unsigned slot, const op_t* ops[TILEGX_MAX_OPERANDS])
+{
+    unsigned num_ops = 0;
+    for (const op_t& op : item.ops) {
+        if (op.type != o_void && static_cast<unsigned>(op.specflag1) == slot && num_ops < TILEGX_MAX_OPERANDS) {
+            ops[num_ops++] = &op;
+        }
+    }
+    return num_ops;
+}
+
+static bool is_reg(const op_t& op, uint16_t reg)
+{
+    return op.type == o_reg && op.reg == reg;
+}
+
+static bool writes_register(const insn_t& item, unsigned slot, uint16_t reg)
+{
+    uint16_t itype = tilegx_item_itype(item, slot);
+    const op_t* ops[TILEGX_MAX_OPERANDS];
+    unsigned num_ops = slot_operands(item, slot, ops);
+
+    for (unsigned n = 0; n < num_ops; ++n) {
+        if (is_reg(*ops[n], reg) && (INSTRUCTIONS[itype].feature & CHG_FLAGS[n])) {
+            return true;
+        }
+    }
+    if (tilegx_itype_is(itype, TILEGX_CLASS_POST_ADD)) {
+        unsigned addr_op = tilegx_itype_is(itype, TILEGX_CLASS_LOAD) ? 1 : 0;
+        return addr_op < num_ops && is_reg(*ops[addr_op], reg);
+    }
+    return false;
+}
 
-    // note: insn_jump and insn_stop do not cause a cref fl_F
-    if (INSTRUCTIONS[cmd->itype].feature & CF_STOP) {
-        //TODO: This is wrong, the code reference should be from the last instruction in the packet
+/**
+ * Whether the slot of item is move rX, sp or addi rX, sp, imm
+ *
+ * @param reg Set to rX
+ * @param spd Set to the sp delta of the function that rX holds afterwards
+ */
+static bool sp_copy(func_t* pfn, const insn_t& item, unsigned slot, uint16_t& reg, sval_t& spd)
+{
+    uint16_t itype = tilegx_item_itype(item, slot);
+    const op_t* ops[TILEGX_MAX_OPERANDS];
+    unsigned num_ops = slot_operands(item, slot, ops);
+    if (num_ops < 2 || ops[0]->type != o_reg || ops[0]->reg == TILEGX_REG_SP ||
+            !is_reg(*ops[1], TILEGX_REG_SP) || !(INSTRUCTIONS[itype].feature & CF_CHG1)) {
+        return false;
+    }
+
+    sval_t imm;
+    if (itype == tilegx_opcode_itype(TILEGX_OPC_MOVE) && num_ops == 2) {
+        imm = 0;
+    }
+    else if (tilegx_itype_is(itype, TILEGX_CLASS_ADD_IMMEDIATE) && num_ops == 3 && ops[2]->type == o_imm) {
+        imm = static_cast<int32_t>(ops[2]->value);
     }
     else {
-        cmd->add_cref(cmd->ea + cmd->size, 0, fl_F);
+        return false;
     }
 
-    for (int i=0 ; i<6 ; i++)
-    {
-        if (cmd->ops[i].type==o_near) {
-            log("adding cref\n");
+    //Slots of a bundle read their registers before any of them writes
+    reg = ops[0]->reg;
+    spd = get_spd(pfn, item.ea & ~7) + imm;
+    return true;
+}
+
+/*
+ * Registers that a function set from sp are noted per function in the
+ * netnode "$ tilegx frame registers", indexed by the function start. The
+ * epilogue that restores sp from the frame register is usually a basic
+ * block of its own, far from the prologue that set it.
+ */
+static const char FRAME_NETNODE_NAME[] = "$ tilegx frame registers";
+static const uchar FRAME_TAG = 'F';
+
+struct TilegxFrameRegister
+{
+    ea_t ea;        //Bundle that set it
+    sval_t spd;
+    uint16_t reg;
+    bool ambiguous; //Set to another value elsewhere in the function
+};
+
+static const size_t MAX_FRAME_REGISTERS = MAXSPECSIZE / sizeof(TilegxFrameRegister);
+
+static size_t load_frame_registers(func_t* pfn, TilegxFrameRegister regs[MAX_FRAME_REGISTERS])
+{
+    netnode node(FRAME_NETNODE_NAME);
+    if (node == BADNODE) {
+        return 0;
+    }
+
+    ssize_t size = node.supval_ea(pfn->start_ea, regs, MAX_FRAME_REGISTERS * sizeof(TilegxFrameRegister), FRAME_TAG);
+    return size > 0 ? size / sizeof(TilegxFrameRegister) : 0;
+}
+
+static void note_frame_register(func_t* pfn, ea_t bundle_ea, uint16_t reg, sval_t spd)
+{
+    TilegxFrameRegister regs[MAX_FRAME_REGISTERS];
+    size_t num_regs = load_frame_registers(pfn, regs);
+
+    TilegxFrameRegister* noted = std::find_if(regs, regs + num_regs, [reg](const TilegxFrameRegister& r) {
+        return r.reg == reg;
+    });
+    if (noted == regs + num_regs) {
+        if (num_regs == MAX_FRAME_REGISTERS) {
+            return;
+        }
+        memset(noted, 0, sizeof(*noted));
+        noted->ea = bundle_ea;
+        noted->spd = spd;
+        noted->reg = reg;
+        ++num_regs;
+    }
+    else if (noted->ea == bundle_ea) {
+        //Analyzed again, the sp delta may have changed since
+        if (noted->spd == spd) {
+            return;
+        }
+        noted->spd = spd;
+    }
+    else if (noted->spd != spd && !noted->ambiguous) {
+        noted->ambiguous = true;
+    }
+    else {
+        return;
+    }
+
+    netnode node(FRAME_NETNODE_NAME, 0, true);
+    node.supset_ea(pfn->start_ea, regs, num_regs * sizeof(TilegxFrameRegister), FRAME_TAG);
+}
+
+static bool find_noted_frame_register(func_t* pfn, uint16_t reg, sval_t& spd)
+{
+    TilegxFrameRegister regs[MAX_FRAME_REGISTERS];
+    size_t num_regs = load_frame_registers(pfn, regs);
+    for (size_t i = 0; i < num_regs; ++i) {
+        if (regs[i].reg == reg) {
+            spd = regs[i].spd;
+            return !regs[i].ambiguous;
+        }
+    }
+    return false;
+}
 
-            if (INSTRUCTIONS[cmd->itype].feature | CF_CALL) {
-                cmd->add_cref(cmd->ops[i].addr, 0, fl_CN);
+enum TilegxFrameSearch
+{
+    TILEGX_FRAME_FOUND,     //Set from sp in the basic block
+    TILEGX_FRAME_CLOBBERED, //Set to something else in the basic block
+    TILEGX_FRAME_UNKNOWN    //Not set in the basic block
+};
+
+/**
+ * Go back through the basic block of bundle_ea to the instruction that set
+ * reg
+ *
+ * @param spd Set to the sp delta of the function that reg holds
+ */
+static TilegxFrameSearch find_frame_register(func_t* pfn, ea_t bundle_ea, uint16_t reg, sval_t& spd)
+{
+    ea_t ea = bundle_ea;
+    for (int i = 0; i < MAX_FRAME_SEARCH; ++i) {
+        //Other predecessors may set it differently
+        if (has_xref(get_flags(ea))) {
+            return TILEGX_FRAME_UNKNOWN;
+        }
+
+        insn_t item;
+        ea = decode_prev_insn(&item, ea);
+        if (ea == BADADDR || !pfn->contains(ea)) {
+            return TILEGX_FRAME_UNKNOWN;
+        }
+
+        for (unsigned slot = 0; slot < tilegx_item_slots(item); ++slot) {
+            if (writes_register(item, slot, reg)) {
+                uint16_t copy_reg;
+                return sp_copy(pfn, item, slot, copy_reg, spd) ? TILEGX_FRAME_FOUND : TILEGX_FRAME_CLOBBERED;
             }
-            else if (INSTRUCTIONS[cmd->itype].feature | CF_JUMP) {
-                cmd->add_cref(cmd->ops[i].addr, 0, fl_JN);
+        }
+    }
+    return TILEGX_FRAME_UNKNOWN;
+}
+
+/**
+ * Find the sp delta of the function that reg holds at bundle_ea, from its
+ * basic block or else from what the function noted for it
+ */
+static bool frame_register_spd(func_t* pfn, ea_t bundle_ea, uint16_t reg, sval_t& spd)
+{
+    switch (find_frame_register(pfn, bundle_ea, reg, spd)) {
+        case TILEGX_FRAME_FOUND:
+            return true;
+        case TILEGX_FRAME_CLOBBERED:
+            return false;
+        default:
+            return find_noted_frame_register(pfn, reg, spd);
+    }
+}
+
+/**
+ * @param delta Set to the sp change of the slot of item
+ * @return Whether the slot changes sp in a way we follow
+ */
+static bool slot_sp_delta(func_t* pfn, const insn_t& item, unsigned slot, sval_t& delta)
+{
+    ea_t bundle_ea = item.ea & ~7;
+    uint16_t itype = tilegx_item_itype(item, slot);
+    const op_t* ops[TILEGX_MAX_OPERANDS];
+    unsigned num_ops = slot_operands(item, slot, ops);
+
+    if (tilegx_itype_is(itype, TILEGX_CLASS_POST_ADD)) {
+        //The address is the first operand of stores and prefetches, the second of loads
+        unsigned addr_op = tilegx_itype_is(itype, TILEGX_CLASS_LOAD) ? 1 : 0;
+        if (num_ops > addr_op + 1 && is_reg(*ops[addr_op], TILEGX_REG_SP) && ops[num_ops - 1]->type == o_imm) {
+            delta = static_cast<int32_t>(ops[num_ops - 1]->value);
+            return true;
+        }
+        return false;
+    }
+
+    if (num_ops < 2 || !is_reg(*ops[0], TILEGX_REG_SP) || !(INSTRUCTIONS[itype].feature & CF_CHG1)) {
+        return false;
+    }
+
+    sval_t imm = 0;
+    bool add_imm = tilegx_itype_is(itype, TILEGX_CLASS_ADD_IMMEDIATE) && num_ops == 3 && ops[2]->type == o_imm;
+    if (add_imm) {
+        imm = static_cast<int32_t>(ops[2]->value);
+    }
+    if ((!add_imm && itype != tilegx_opcode_itype(TILEGX_OPC_MOVE)) || ops[1]->type != o_reg) {
+        return false;
+    }
+
+    if (ops[1]->reg == TILEGX_REG_SP) {
+        delta = imm;
+        return true;
+    }
+
+    sval_t spd;
+    if (frame_register_spd(pfn, bundle_ea, ops[1]->reg, spd)) {
+        delta = spd + imm - get_spd(pfn, bundle_ea);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Add the sp change of the items of a bundle as one stack point, which
+ * takes effect after the bundle. Recognizes what gcc emits: addi, addli,
+ * addxli sp, sp, imm; st_add and ld_add with sp as address; and move sp, rX
+ * or addi sp, rX, imm with rX set from sp, earlier in the basic block or
+ * anywhere in the function.
+ */
+static void trace_sp(func_t* pfn, const insn_t* const items[], size_t num_items)
+{
+    ea_t bundle_ea = items[0]->ea & ~7;
+    bool found = false;
+    sval_t delta = 0;
+    for (size_t i = 0; i < num_items; ++i) {
+        for (unsigned slot = 0; slot < tilegx_item_slots(*items[i]); ++slot) {
+            sval_t slot_delta;
+            if (slot_sp_delta(pfn, *items[i], slot, slot_delta)) {
+                found = true;
+                delta += slot_delta;
+            }
+        }
+    }
+
+    //The slots above read the frame registers before this bundle sets them
+    for (size_t i = 0; i < num_items; ++i) {
+        for (unsigned slot = 0; slot < tilegx_item_slots(*items[i]); ++slot) {
+            uint16_t reg;
+            sval_t spd;
+            if (sp_copy(pfn, *items[i], slot, reg, spd)) {
+                note_frame_register(pfn, bundle_ea, reg, spd);
             }
-            else {
-                msg("WEIRD: o_near operand type in an instruction that is neither call nor jump at ea 0x%" FMT_EA "x\n", cmd->ea);
+        }
+    }
+
+    if (found) {
+        add_auto_stkpnt(pfn, bundle_ea + TILEGX_BUNDLE_SIZE, delta);
+    }
+}
+
+void tilegx_forget_frame_registers(ea_t func_ea)
+{
+    netnode node(FRAME_NETNODE_NAME);
+    if (node != BADNODE) {
+        node.supdel_ea(func_ea, FRAME_TAG);
+    }
+}
+
+ssize_t tilegx_emu_insn(const insn_t* cmd)
+{
+    log("emu(%08" FMT_EA "x), itype=%d\n", cmd->ea, cmd->itype);
+
+    //The slots of a bundle execute together, so the items of a bundle flow
+    //into each other and only the last one goes elsewhere
+    ea_t bundle_ea = cmd->ea & ~7;
+    ea_t next_ea = cmd->ea + cmd->size;
+    if (next_ea != bundle_ea + TILEGX_BUNDLE_SIZE) {
+        cmd->add_cref(next_ea, 0, fl_F);
+    }
+    else {
+        func_t* pfn = may_trace_sp() ? get_func(cmd->ea) : nullptr;
+
+        //The earlier slots are items of their own unless the bundle is one.
+        //They only matter if the scan found a control flow slot, or for sp.
+        insn_t decoded[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE - 1];
+        const insn_t* items[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+        size_t num_items = 0;
+        ea_t first_ea = pfn || tilegx_flow_kinds(bundle_ea) ? bundle_ea : cmd->ea;
+        for (ea_t ea = first_ea; ea < cmd->ea && num_items < TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE - 1; ) {
+            int len = decode_insn(&decoded[num_items], ea);
+            if (len <= 0) {
+                break;
             }
+            items[num_items] = &decoded[num_items];
+            ++num_items;
+            ea += len;
+        }
+        items[num_items++] = cmd;
+
+        bool stop = false;
+        for (size_t i = 0; i < num_items; ++i) {
+            add_flow_refs(cmd, *items[i], stop);
+        }
+
+        // note: insn_jump and insn_stop do not cause a cref fl_F
+        if (!stop) {
+            cmd->add_cref(next_ea, 0, fl_F);
+        }
+
+        //Once per bundle, the slots change sp together
+        if (pfn) {
+            trace_sp(pfn, items, num_items);
         }
-        else if (cmd->ops[i].type==o_mem) {
+    }
+
+    for (int i=0 ; i<UA_MAXOP ; i++)
+    {
+        if (cmd->ops[i].type==o_mem) {
             log("adding dref\n");
             // todo: figure out if we are loading or storing.
             cmd->add_dref(cmd->ops[i].addr, i, dr_R);
@@ -67,9 +439,6 @@ ssize_t tilegx_emu_insn(const insn_t* cmd)
         }
     }
 
-    // trace stack pointer -> add_auto_stkpnt2(get_func(cmd->ea), cmd->ea+cmd->size, delta);
-    // r29 = {add|sub}(r29, #)
-    //
     // create stackvars:
     //     ua_stkvar2(x, x.addr, 0) && op_stkvar(cmd->ea, x.n)
     return 1;
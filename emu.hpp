@@ -21,4 +21,9 @@
 
 ssize_t tilegx_emu_insn(const insn_t* cmd);
 
+/**
+ * Drop what was noted about the frame registers of the function at func_ea
+ */
+void tilegx_forget_frame_registers(ea_t func_ea);
+
 #endif /* _TILEGX_EMU_HPP */
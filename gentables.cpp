@@ -0,0 +1,525 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+/**
+ * Build time generator for the decoder tables in dec.cpp and the instruction
+ * table in ins.cpp.
+ *
+ * This is a host tool. It links binutils' libopcodes only to read
+ * tilegx_opcodes[], tilegx_operands[] and tilegx_sprs[] and writes them out
+ * as constexpr C++ tables. Before anything is written, the decoder built from
+ * the tables is checked against parse_insn_tilegx, so a table that disagrees
+ * with libopcodes fails the build instead of producing wrong disassembly.
+ *
+ * Usage: gentables opcodes|tables|instructions
+ */
+
+//libopcodes imports
+extern "C" {
+#include <tilegx.h>
+}
+
+//stdlib imports
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static const unsigned NUM_OPCODES = TILEGX_OPC_NONE + 1;
+static const unsigned NUM_PIPELINES = TILEGX_NUM_PIPELINE_ENCODINGS;
+static const char* const PIPELINE_NAMES[NUM_PIPELINES] = { "X0", "X1", "Y0", "Y1", "Y2" };
+
+//Widest bit field a decode node may switch on
+static const unsigned MAX_FIELD_WIDTH = 10;
+
+struct Segment
+{
+    unsigned src_shift;
+    unsigned width;
+    unsigned dst_shift;
+};
+
+struct Candidate
+{
+    uint64_t mask;
+    uint64_t value;
+    unsigned opcode;
+};
+
+struct Node
+{
+    unsigned index;
+    unsigned shift;
+    unsigned width;
+    unsigned count;
+};
+
+static std::vector< std::vector< Segment > > operand_segments;
+static std::vector< Node > nodes;
+static std::vector< Candidate > candidates;
+static unsigned roots[NUM_PIPELINES];
+
+static unsigned num_operands()
+{
+    //tilegx_operands[] has no terminator, so count the operands that are used
+    int max = -1;
+    for (unsigned opc = 0; opc < NUM_OPCODES; ++opc) {
+        for (unsigned pipe = 0; pipe < NUM_PIPELINES; ++pipe) {
+            for (unsigned i = 0; i < tilegx_opcodes[opc].num_operands; ++i) {
+                max = std::max(max, static_cast<int>(tilegx_opcodes[opc].operands[pipe][i]));
+            }
+        }
+    }
+    return static_cast<unsigned>(max + 1);
+}
+
+/**
+ * Find out where the bits of an operand live in the bundle by feeding single
+ * bits to its extract function, and merge them into contiguous segments.
+ */
+static bool probe_operand(unsigned idx, std::vector< Segment >& segments)
+{
+    const tilegx_operand& op = tilegx_operands[idx];
+
+    for (unsigned bit = 0; bit < 64; ++bit) {
+        unsigned int raw = op.extract(1ULL << bit);
+        if (raw == 0) {
+            continue;
+        }
+        if (raw & (raw - 1)) {
+            fprintf(stderr, "operand %u: bundle bit %u maps to several operand bits\n", idx, bit);
+            return false;
+        }
+
+        unsigned dst = __builtin_ctz(raw);
+        if (!segments.empty() &&
+            segments.back().src_shift + segments.back().width == bit &&
+            segments.back().dst_shift + segments.back().width == dst) {
+            ++segments.back().width;
+        }
+        else {
+            segments.push_back(Segment {bit, 1, dst});
+        }
+    }
+
+    if (segments.size() > 2) {
+        fprintf(stderr, "operand %u: more than two bit segments\n", idx);
+        return false;
+    }
+    return true;
+}
+
+static unsigned longest_run(uint64_t bits, unsigned* shift)
+{
+    unsigned best = 0;
+    for (unsigned start = 0; start < 64; ) {
+        if (!(bits & (1ULL << start))) {
+            ++start;
+            continue;
+        }
+        unsigned end = start;
+        while (end < 64 && (bits & (1ULL << end))) {
+            ++end;
+        }
+        if (end - start > best) {
+            best = end - start;
+            *shift = start;
+        }
+        start = end;
+    }
+    return std::min(best, MAX_FIELD_WIDTH);
+}
+
+static unsigned popcount(uint64_t bits)
+{
+    return __builtin_popcountll(bits);
+}
+
+/**
+ * Build the decode tree for a set of candidates. Every internal node switches
+ * on a bit field that all remaining candidates constrain; what is left ends
+ * up in a leaf that is checked linearly, most specific encoding first (this
+ * is what lets pseudo instructions like move win over or).
+ */
+static void build_node(unsigned node_idx, std::vector< Candidate > cands, uint64_t tested)
+{
+    uint64_t common = ~tested;
+    for (const Candidate& cand : cands) {
+        common &= cand.mask;
+    }
+
+    unsigned shift = 0;
+    unsigned width = longest_run(common, &shift);
+    if (cands.size() <= 1 || width == 0) {
+        std::stable_sort(cands.begin(), cands.end(), [](const Candidate& a, const Candidate& b) {
+            return popcount(a.mask) > popcount(b.mask);
+        });
+        nodes[node_idx] = Node {static_cast<unsigned>(candidates.size()), 0, 0, static_cast<unsigned>(cands.size())};
+        candidates.insert(candidates.end(), cands.begin(), cands.end());
+        return;
+    }
+
+    uint64_t field_mask = (1ULL << width) - 1;
+    unsigned first = static_cast<unsigned>(nodes.size());
+    nodes.resize(first + (1u << width));
+    nodes[node_idx] = Node {first, shift, width, 0};
+
+    for (uint64_t val = 0; val <= field_mask; ++val) {
+        std::vector< Candidate > sub;
+        for (const Candidate& cand : cands) {
+            if (((cand.value >> shift) & field_mask) == val) {
+                sub.push_back(cand);
+            }
+        }
+        build_node(first + static_cast<unsigned>(val), sub, tested | (field_mask << shift));
+    }
+}
+
+static void build_tree()
+{
+    for (unsigned pipe = 0; pipe < NUM_PIPELINES; ++pipe) {
+        std::vector< Candidate > cands;
+        for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+            const tilegx_opcode& opcode = tilegx_opcodes[opc];
+            if (opcode.pipes & (1 << pipe)) {
+                cands.push_back(Candidate {opcode.fixed_bit_masks[pipe], opcode.fixed_bit_values[pipe], opc});
+            }
+        }
+
+        roots[pipe] = static_cast<unsigned>(nodes.size());
+        nodes.resize(nodes.size() + 1);
+        build_node(roots[pipe], cands, 0);
+    }
+}
+
+static unsigned find_opcode(tilegx_bundle_bits bits, unsigned pipe)
+{
+    const Node* node = &nodes[roots[pipe]];
+    while (node->width) {
+        node = &nodes[node->index + ((bits >> node->shift) & ((1ULL << node->width) - 1))];
+    }
+    for (unsigned i = 0; i < node->count; ++i) {
+        const Candidate& cand = candidates[node->index + i];
+        if ((bits & cand.mask) == cand.value) {
+            return cand.opcode;
+        }
+    }
+    return TILEGX_OPC_NONE;
+}
+
+static long long extract_operand(tilegx_bundle_bits bits, unsigned long long pc, unsigned idx)
+{
+    const tilegx_operand& op = tilegx_operands[idx];
+    uint64_t raw = 0;
+
+    for (const Segment& seg : operand_segments[idx]) {
+        raw |= ((bits >> seg.src_shift) & ((1ULL << seg.width) - 1)) << seg.dst_shift;
+    }
+
+    long long val = static_cast<long long>(raw);
+    if (op.is_signed) {
+        long long sign = 1LL << (op.num_bits - 1);
+        val = ((val & (sign + sign - 1)) ^ sign) - sign;
+    }
+    if (op.type == TILEGX_OP_TYPE_ADDRESS) {
+        val = val * TILEGX_BUNDLE_SIZE_IN_BYTES + pc;
+    }
+    return val;
+}
+
+static bool check_bundle(tilegx_bundle_bits bits)
+{
+    const unsigned long long pc = 0x10000;
+    tilegx_decoded_instruction decoded[TILEGX_MAX_INSTRUCTIONS_PER_BUNDLE];
+    int num_instructions = parse_insn_tilegx(bits, pc, decoded);
+    unsigned min_pipe = (bits & TILEGX_BUNDLE_MODE_MASK) ? TILEGX_PIPELINE_Y0 : TILEGX_PIPELINE_X0;
+
+    for (int i = 0; i < num_instructions; ++i) {
+        unsigned pipe = min_pipe + i;
+        unsigned expected = static_cast<unsigned>(decoded[i].opcode - tilegx_opcodes);
+        unsigned opc = find_opcode(bits, pipe);
+
+        if (opc != expected) {
+            fprintf(stderr, "bundle 0x%016llx pipe %s: decoded opcode %u, libopcodes says %u\n",
+                    bits, PIPELINE_NAMES[pipe], opc, expected);
+            return false;
+        }
+        for (unsigned j = 0; j < tilegx_opcodes[opc].num_operands; ++j) {
+            long long val = extract_operand(bits, pc, tilegx_opcodes[opc].operands[pipe][j]);
+            if (val != decoded[i].operand_values[j]) {
+                fprintf(stderr, "bundle 0x%016llx pipe %s: operand %u is %lld, libopcodes says %lld\n",
+                        bits, PIPELINE_NAMES[pipe], j, val, decoded[i].operand_values[j]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Compare the generated decoder with parse_insn_tilegx on encodings of every
+ * opcode in every pipeline with random operand bits, and on random bundles.
+ */
+static bool verify()
+{
+    std::mt19937_64 rng(0x711e6);
+
+    for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+        const tilegx_opcode& opcode = tilegx_opcodes[opc];
+        for (unsigned pipe = 0; pipe < NUM_PIPELINES; ++pipe) {
+            if (!(opcode.pipes & (1 << pipe))) {
+                continue;
+            }
+            for (unsigned n = 0; n < 256; ++n) {
+                tilegx_bundle_bits bits = (rng() & ~opcode.fixed_bit_masks[pipe]) | opcode.fixed_bit_values[pipe];
+                if (pipe <= TILEGX_PIPELINE_X1) {
+                    bits &= ~TILEGX_BUNDLE_MODE_MASK;
+                }
+                else if (!(bits & TILEGX_BUNDLE_MODE_MASK)) {
+                    bits |= 1ULL << 62;
+                }
+                if (!check_bundle(bits)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    for (unsigned n = 0; n < (1u << 20); ++n) {
+        if (!check_bundle(rng())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string upper(const char* name)
+{
+    std::string str(name);
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return static_cast<char>(toupper(c)); });
+    return str;
+}
+
+static void write_opcodes()
+{
+    printf("//Generated by gentables from binutils' tilegx-opc.c. Do not edit.\n\n");
+    printf("enum TilegxOpcode : uint16_t\n{\n");
+    for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+        printf("    TILEGX_OPC_%s,\n", upper(tilegx_opcodes[opc].name).c_str());
+    }
+    printf("    TILEGX_OPC_NONE\n};\n\n");
+
+    printf("static constexpr const char* TILEGX_OPCODE_NAMES[] = {\n");
+    for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+        printf("    \"%s\",\n", tilegx_opcodes[opc].name);
+    }
+    printf("    nullptr\n};\n");
+}
+
+//Control flow the operand descriptions do not tell
+static const char* const STOP_MNEMONICS[] = {
+    "iret", "j", "jr", "jrp", "raise", "swint0", "swint1", "swint2", "swint3"
+};
+
+/**
+ * IDA feature flags of the opcode: operand roles from the operand
+ * descriptions, control flow from the mnemonic and pc relative operands
+ */
+static std::string instruction_feature(const tilegx_opcode& opcode)
+{
+    std::vector< std::string > flags;
+
+    //The operands play the same roles in every pipeline
+    unsigned pipe = 0;
+    while (!(opcode.pipes & (1 << pipe))) {
+        ++pipe;
+    }
+
+    bool pc_relative = false;
+    for (unsigned i = 0; i < opcode.num_operands; ++i) {
+        const tilegx_operand& op = tilegx_operands[opcode.operands[pipe][i]];
+        if (op.is_dest_reg) {
+            flags.push_back("CF_CHG" + std::to_string(i + 1));
+        }
+        if (op.is_src_reg || op.type != TILEGX_OP_TYPE_REGISTER) {
+            flags.push_back("CF_USE" + std::to_string(i + 1));
+        }
+        pc_relative = pc_relative || op.is_pc_relative;
+    }
+
+    if (strncmp(opcode.name, "jal", 3) == 0) {
+        flags.push_back("CF_CALL");
+    }
+    else if (opcode.name[0] == 'j' || pc_relative) {
+        flags.push_back("CF_JUMP");
+    }
+    for (const char* name : STOP_MNEMONICS) {
+        if (strcmp(opcode.name, name) == 0) {
+            flags.push_back("CF_STOP");
+        }
+    }
+
+    std::string feature;
+    for (const std::string& flag : flags) {
+        feature += (feature.empty() ? "" : " | ") + flag;
+    }
+    return feature.empty() ? "0" : feature;
+}
+
+static void write_instructions()
+{
+    printf("//Generated by gentables from binutils' tilegx-opc.c. Do not edit.\n\n");
+    printf("//Entries of INSTRUCTIONS after itype 0, in TilegxOpcode order\n");
+    for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+        std::string name = std::string("\"") + tilegx_opcodes[opc].name + "\",";
+        printf("    {%-21s %s},\n", name.c_str(), instruction_feature(tilegx_opcodes[opc]).c_str());
+    }
+}
+
+static void write_tables()
+{
+    static const char* const TYPE_NAMES[] = {
+        "TILEGX_OPERAND_REGISTER", "TILEGX_OPERAND_IMMEDIATE", "TILEGX_OPERAND_ADDRESS", "TILEGX_OPERAND_SPR"
+    };
+
+    printf("//Generated by gentables from binutils' tilegx-opc.c. Do not edit.\n\n");
+
+    printf("static constexpr TilegxOperandDesc TILEGX_OPERAND_DESCS[] = {\n");
+    for (unsigned idx = 0; idx < operand_segments.size(); ++idx) {
+        const tilegx_operand& op = tilegx_operands[idx];
+        const std::vector< Segment >& segs = operand_segments[idx];
+        Segment seg0 = segs.size() > 0 ? segs[0] : Segment {0, 0, 0};
+        Segment seg1 = segs.size() > 1 ? segs[1] : Segment {0, 0, 0};
+        printf("    {%s, %u, %s, %u, {{%u, %u, %u}, {%u, %u, %u}}},\n",
+               TYPE_NAMES[op.type], op.num_bits, op.is_signed ? "true" : "false",
+               static_cast<unsigned>(segs.size()),
+               seg0.src_shift, seg0.width, seg0.dst_shift,
+               seg1.src_shift, seg1.width, seg1.dst_shift);
+    }
+    printf("};\n\n");
+
+    printf("static constexpr TilegxOpcodeDesc TILEGX_OPCODE_DESCS[] = {\n");
+    for (unsigned opc = 0; opc < NUM_OPCODES; ++opc) {
+        const tilegx_opcode& opcode = tilegx_opcodes[opc];
+        printf("    {0x%02x, %u, %s, {",
+               opcode.pipes, opcode.num_operands, opcode.can_bundle ? "true" : "false");
+        for (unsigned pipe = 0; pipe < NUM_PIPELINES; ++pipe) {
+            printf("%s{", pipe ? ", " : "");
+            for (unsigned i = 0; i < TILEGX_MAX_OPERANDS; ++i) {
+                int idx = i < opcode.num_operands && (opcode.pipes & (1 << pipe)) ? opcode.operands[pipe][i] : -1;
+                printf("%s%d", i ? ", " : "", idx);
+            }
+            printf("}");
+        }
+        printf("}},\n");
+    }
+    printf("};\n\n");
+
+    //Fixed bits of every opcode in every pipeline, zero where it is not available
+    printf("static constexpr TilegxEncoding TILEGX_OPCODE_ENCODINGS[][%u] = {\n", NUM_PIPELINES);
+    for (unsigned opc = 0; opc < NUM_OPCODES; ++opc) {
+        const tilegx_opcode& opcode = tilegx_opcodes[opc];
+        printf("    {");
+        for (unsigned pipe = 0; pipe < NUM_PIPELINES; ++pipe) {
+            bool available = (opcode.pipes & (1 << pipe)) != 0;
+            printf("%s{0x%016" PRIx64 "ULL, 0x%016" PRIx64 "ULL}", pipe ? ", " : "",
+                   available ? static_cast<uint64_t>(opcode.fixed_bit_masks[pipe]) : 0,
+                   available ? static_cast<uint64_t>(opcode.fixed_bit_values[pipe]) : 0);
+        }
+        printf("},\n");
+    }
+    printf("};\n\n");
+
+    printf("static constexpr TilegxDecodeNode TILEGX_DECODE_NODES[] = {\n");
+    for (const Node& node : nodes) {
+        printf("    {%u, %u, %u, %u},\n", node.index, node.shift, node.width, node.count);
+    }
+    printf("};\n\n");
+
+    printf("static constexpr TilegxDecodeCandidate TILEGX_DECODE_CANDIDATES[] = {\n");
+    for (const Candidate& cand : candidates) {
+        printf("    {0x%016" PRIx64 "ULL, 0x%016" PRIx64 "ULL, TILEGX_OPC_%s},\n",
+               cand.mask, cand.value, upper(tilegx_opcodes[cand.opcode].name).c_str());
+    }
+    printf("};\n\n");
+
+    printf("static constexpr uint16_t TILEGX_DECODE_ROOTS[] = {");
+    for (unsigned pipe = 0; pipe < NUM_PIPELINES; ++pipe) {
+        printf("%s%u", pipe ? ", " : "", roots[pipe]);
+    }
+    printf("};\n\n");
+
+    //tilegx_sprs[] is sorted by number, so the decoder can bsearch it
+    printf("static constexpr TilegxSpr TILEGX_SPRS[] = {\n");
+    for (int i = 0; i < tilegx_num_sprs; ++i) {
+        printf("    {%d, \"%s\"},\n", tilegx_sprs[i].number, tilegx_sprs[i].name);
+    }
+    printf("};\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 || (strcmp(argv[1], "opcodes") != 0 && strcmp(argv[1], "tables") != 0 &&
+                      strcmp(argv[1], "instructions") != 0)) {
+        fprintf(stderr, "Usage: %s opcodes|tables|instructions\n", argv[0]);
+        return 1;
+    }
+
+    for (unsigned opc = 0; opc < NUM_OPCODES; ++opc) {
+        if (tilegx_opcodes[opc].mnemonic != static_cast<tilegx_mnemonic>(opc)) {
+            fprintf(stderr, "tilegx_opcodes[%u] is out of order\n", opc);
+            return 1;
+        }
+    }
+
+    operand_segments.resize(num_operands());
+    for (unsigned idx = 0; idx < operand_segments.size(); ++idx) {
+        if (!probe_operand(idx, operand_segments[idx])) {
+            return 1;
+        }
+    }
+
+    build_tree();
+    if (nodes.size() > 0xffff || candidates.size() > 0xffff) {
+        fprintf(stderr, "decode tables too large\n");
+        return 1;
+    }
+    for (const Node& node : nodes) {
+        if (node.count > 0xff) {
+            fprintf(stderr, "decode leaf with %u candidates\n", node.count);
+            return 1;
+        }
+    }
+
+    if (!verify()) {
+        return 1;
+    }
+
+    if (strcmp(argv[1], "opcodes") == 0) {
+        write_opcodes();
+    }
+    else if (strcmp(argv[1], "tables") == 0) {
+        write_tables();
+    }
+    else {
+        write_instructions();
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_HASH_HPP
+#define _TILEGX_HASH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+constexpr uint32_t tilegx_name_hash(std::string_view name, uint32_t seed)
+{
+    //FNV-1a with a final mix, so that the low bits are usable as index
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+/**
+ * Perfect hash over a fixed table of NumNames names, built at compile time
+ * with hash and displace: the names are spread over NumBuckets buckets, and
+ * every bucket gets the seed of a second hash that moves all its names to
+ * free slots. A lookup is two hashes and one string compare.
+ *
+ * Names is any constexpr callable mapping an index to a std::string_view.
+ * Empty names and duplicates (only the first one counts) are not entered.
+ */
+template< size_t NumNames, size_t NumSlots, size_t NumBuckets >
+class TilegxPerfectHash
+{
+public:
+    template< typename Names >
+    constexpr TilegxPerfectHash(Names names) : seeds_(), slots_()
+    {
+        for (size_t i = 0; i < NumSlots; ++i) {
+            slots_[i] = -1;
+        }
+
+        size_t buckets[NumNames] = {};
+        size_t sizes[NumBuckets] = {};
+        for (size_t i = 0; i < NumNames; ++i) {
+            buckets[i] = NumBuckets;
+            if (names(i).empty()) {
+                continue;
+            }
+
+            bool duplicate = false;
+            for (size_t j = 0; j < i && !duplicate; ++j) {
+                duplicate = names(j) == names(i);
+            }
+            if (!duplicate) {
+                buckets[i] = tilegx_name_hash(names(i), 0) % NumBuckets;
+                ++sizes[buckets[i]];
+            }
+        }
+
+        //Largest buckets first, they are the hardest to place
+        bool done[NumBuckets] = {};
+        for (size_t round = 0; round < NumBuckets; ++round) {
+            size_t bucket = 0;
+            for (size_t b = 1; b < NumBuckets; ++b) {
+                if (done[bucket] || (!done[b] && sizes[b] > sizes[bucket])) {
+                    bucket = b;
+                }
+            }
+            done[bucket] = true;
+            if (sizes[bucket] == 0) {
+                break;
+            }
+
+            uint16_t seed = 1;
+            while (!try_place(names, buckets, bucket, seed)) {
+                if (++seed == UINT16_MAX) {
+                    throw "TilegxPerfectHash: no seed found, increase NumSlots";
+                }
+            }
+            seeds_[bucket] = seed;
+        }
+    }
+
+    /**
+     * @return Index of name in the table, or -1 if it is not in there
+     */
+    template< typename Names >
+    constexpr int find(Names names, std::string_view name) const
+    {
+        uint16_t seed = seeds_[tilegx_name_hash(name, 0) % NumBuckets];
+        if (seed == 0) {
+            return -1;
+        }
+
+        int idx = slots_[tilegx_name_hash(name, seed) % NumSlots];
+        return idx >= 0 && names(idx) == name ? idx : -1;
+    }
+
+private:
+    template< typename Names >
+    constexpr bool try_place(Names names, const size_t (&buckets)[NumNames], size_t bucket, uint16_t seed)
+    {
+        size_t placed[NumNames] = {};
+        size_t num_placed = 0;
+
+        for (size_t i = 0; i < NumNames; ++i) {
+            if (buckets[i] != bucket) {
+                continue;
+            }
+
+            size_t slot = tilegx_name_hash(names(i), seed) % NumSlots;
+            if (slots_[slot] >= 0) {
+                //Taken by another bucket or by this one, undo this attempt
+                while (num_placed) {
+                    slots_[placed[--num_placed]] = -1;
+                }
+                return false;
+            }
+            slots_[slot] = static_cast<int16_t>(i);
+            placed[num_placed++] = slot;
+        }
+        return true;
+    }
+
+    uint16_t seeds_[NumBuckets]; //0 for empty buckets
+    int16_t slots_[NumSlots];    //Index into the name table, -1 for free slots
+};
+
+#endif /* _TILEGX_HASH_HPP */
@@ -0,0 +1,139 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "idb.hpp"
+#include "cache.hpp"
+#include "ctx.hpp"
+#include "diag.hpp"
+#include "emu.hpp"
+#include "mem.hpp"
+#include "pre.hpp"
+#include "scan.hpp"
+#include "log.hpp"
+
+//stdlib imports
+#include <algorithm>
+
+//IDA Pro imports
+#include <idp.hpp>
+#include <funcs.hpp>
+#include <segment.hpp>
+
+static void invalidate(ea_t start_ea, ea_t end_ea)
+{
+    //The background workers read the snapshots
+    tilegx_background_pause();
+    tilegx_snapshot_invalidate(start_ea, end_ea);
+    tilegx_flow_invalidate(start_ea, end_ea);
+    tilegx_cache_invalidate(start_ea, end_ea);
+}
+
+static ssize_t idaapi idb_callback(void*, int code, va_list va)
+{
+    switch (code) {
+        case idb_event::savebase:
+            tilegx_cache_save();
+            break;
+        case idb_event::closebase:
+        {
+            //The module can stay loaded for the next database
+            TilegxContext& ctx = tilegx_context();
+            tilegx_background_stop();
+            tilegx_cache_clear();
+            tilegx_flow_invalidate(0, BADADDR);
+            tilegx_snapshot_clear();
+            tilegx_diag_clear();
+            ctx.lookahead_ea = BADADDR;
+            ctx.lookahead_window = 0;
+            break;
+        }
+        case idb_event::byte_patched:
+        {
+            ea_t ea = va_arg(va, ea_t);
+            log("byte_patched(%08" FMT_EA "x)\n", ea);
+            tilegx_background_pause();
+            tilegx_snapshot_refresh(ea, ea + 1);
+            tilegx_flow_invalidate(ea, ea + 1);
+            tilegx_cache_invalidate(ea & ~7, (ea & ~7) + TILEGX_BUNDLE_SIZE);
+            break;
+        }
+        case idb_event::segm_deleted:
+        {
+            ea_t start_ea = va_arg(va, ea_t);
+            ea_t end_ea = va_arg(va, ea_t);
+            invalidate(start_ea, end_ea);
+            tilegx_cache_delete_saved(start_ea);
+            break;
+        }
+        case idb_event::segm_start_changed:
+        {
+            segment_t* seg = va_arg(va, segment_t*);
+            ea_t old_start_ea = va_arg(va, ea_t);
+            invalidate(std::min(seg->start_ea, old_start_ea), seg->end_ea);
+            //Saved tables are keyed by the segment start
+            tilegx_cache_delete_saved(old_start_ea);
+            break;
+        }
+        case idb_event::segm_end_changed:
+        {
+            segment_t* seg = va_arg(va, segment_t*);
+            ea_t old_end_ea = va_arg(va, ea_t);
+            invalidate(seg->start_ea, std::max(seg->end_ea, old_end_ea));
+            break;
+        }
+        case idb_event::segm_moved:
+        {
+            ea_t from = va_arg(va, ea_t);
+            ea_t to = va_arg(va, ea_t);
+            asize_t size = va_arg(va, asize_t);
+            invalidate(from, from + size);
+            invalidate(to, to + size);
+            tilegx_cache_delete_saved(from);
+            break;
+        }
+        case idb_event::allsegs_moved:
+        {
+            segm_move_infos_t* infos = va_arg(va, segm_move_infos_t*);
+            for (const segm_move_info_t& info : *infos) {
+                invalidate(info.from, info.from + info.size);
+                invalidate(info.to, info.to + info.size);
+                tilegx_cache_delete_saved(info.from);
+            }
+            break;
+        }
+        case idb_event::deleting_func:
+        {
+            func_t* pfn = va_arg(va, func_t*);
+            tilegx_forget_frame_registers(pfn->start_ea);
+            break;
+        }
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+void tilegx_hook_idb_events()
+{
+    hook_to_notification_point(HT_IDB, idb_callback);
+}
+
+void tilegx_unhook_idb_events()
+{
+    unhook_from_notification_point(HT_IDB, idb_callback);
+}
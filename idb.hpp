@@ -0,0 +1,28 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_IDB_HPP
+#define _TILEGX_IDB_HPP
+
+/**
+ * Keep the decode cache in sync with the database: patched bytes and
+ * deleted, moved or resized segments invalidate the affected bundles, and
+ * the cache is saved with the database.
+ */
+void tilegx_hook_idb_events();
+void tilegx_unhook_idb_events();
+
+#endif /* _TILEGX_IDB_HPP */
@@ -19,7 +19,58 @@
 
 #include <idp.hpp>
 
+#include "dec.hpp"
+
+#include <array>
+
 extern const instruc_t INSTRUCTIONS[];
 extern const size_t NUM_INSTRUCTIONS;
 
+/**
+ * Classes of instructions, bits of TILEGX_ITYPE_CLASSES
+ */
+enum TilegxInsnClass : uint16_t
+{
+    TILEGX_CLASS_COND_BRANCH   = 1 << 0,  //b*z, b*zt, blb*
+    TILEGX_CLASS_DIRECT_JUMP   = 1 << 1,  //j
+    TILEGX_CLASS_CALL          = 1 << 2,  //jal
+    TILEGX_CLASS_INDIRECT_CALL = 1 << 3,  //jalr, jalrp
+    TILEGX_CLASS_RETURN        = 1 << 4,  //jr, jrp, a return if the target is lr
+    TILEGX_CLASS_LOAD          = 1 << 5,  //ld*
+    TILEGX_CLASS_STORE         = 1 << 6,  //st*
+    TILEGX_CLASS_ATOMIC        = 1 << 7,  //cmpexch*, exch*, fetch*
+    TILEGX_CLASS_SPR           = 1 << 8,  //mfspr, mtspr
+    TILEGX_CLASS_PREFETCH      = 1 << 9,  //prefetch*
+    TILEGX_CLASS_SWINT         = 1 << 10, //swint*
+    TILEGX_CLASS_ADD_IMMEDIATE = 1 << 11, //addi, addli, addxi, addxli
+    TILEGX_CLASS_POST_ADD      = 1 << 12, //ld*_add, st*_add, prefetch_add*: the address register is incremented
+
+    //Instructions with a code address operand
+    TILEGX_CLASS_CODE_TARGET = TILEGX_CLASS_COND_BRANCH | TILEGX_CLASS_DIRECT_JUMP | TILEGX_CLASS_CALL
+};
+
+/**
+ * TilegxInsnClass bits of every itype, computed at compile time
+ */
+extern const std::array< uint16_t, TILEGX_OPC_NONE + 1 > TILEGX_ITYPE_CLASSES;
+
+/**
+ * @param classes TilegxInsnClass bits
+ * @return Whether itype belongs to one of the classes
+ */
+inline bool tilegx_itype_is(uint16_t itype, uint16_t classes)
+{
+    return (TILEGX_ITYPE_CLASSES[itype] & classes) != 0;
+}
+
+/**
+ * @return itype of the decoder opcode, 0 for TILEGX_OPC_NONE
+ */
+uint16_t tilegx_opcode_itype(TilegxOpcode opcode);
+
+/**
+ * @return Decoder opcode of the itype, TILEGX_OPC_NONE for 0
+ */
+TilegxOpcode tilegx_itype_opcode(uint16_t itype);
+
 #endif /* _TILEGX_INS_HPP */
@@ -0,0 +1,189 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "mem.hpp"
+#include "cache.hpp"
+#include "ctx.hpp"
+#include "dec.hpp"
+
+//stdlib imports
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+//IDA Pro imports
+#include <bytes.hpp>
+#include <segment.hpp>
+
+namespace {
+
+struct TilegxSegmentSnapshot : TilegxSnapshot
+{
+    std::vector< uint8_t > byte_buf;
+    std::vector< uint8_t > mask_buf;
+
+    size_t memory_size() const {
+        return byte_buf.size() + mask_buf.size();
+    }
+};
+
+struct TilegxSnapshotState : TilegxContextPart
+{
+    //Sorted by start_ea
+    std::vector< std::unique_ptr< TilegxSegmentSnapshot > > snapshots;
+    TilegxSegmentSnapshot* last_snapshot = nullptr;
+};
+
+TilegxSnapshotState& snapshot_state()
+{
+    std::unique_ptr< TilegxContextPart >& part = tilegx_context().snapshots;
+    if (!part) {
+        part.reset(new TilegxSnapshotState());
+    }
+    return static_cast<TilegxSnapshotState&>(*part);
+}
+
+/**
+ * Read [start_ea, end_ea) of the snapshot, both must be bundle aligned
+ */
+void read_snapshot(TilegxSegmentSnapshot* snapshot, ea_t start_ea, ea_t end_ea)
+{
+    //The mask has one bit per byte, so one mask byte per bundle
+    size_t offset = start_ea - snapshot->start_ea;
+    get_bytes(&snapshot->byte_buf[offset], end_ea - start_ea, start_ea, GMB_READALL,
+              &snapshot->mask_buf[offset / TILEGX_BUNDLE_SIZE]);
+}
+
+TilegxSegmentSnapshot* find_snapshot(ea_t ea, bool create)
+{
+    TilegxSnapshotState& state = snapshot_state();
+    if (state.last_snapshot && ea >= state.last_snapshot->start_ea && ea < state.last_snapshot->end_ea) {
+        return state.last_snapshot;
+    }
+
+    auto itr = std::upper_bound(state.snapshots.begin(), state.snapshots.end(), ea,
+        [](ea_t addr, const std::unique_ptr< TilegxSegmentSnapshot >& snapshot) {
+            return addr < snapshot->start_ea;
+        });
+    if (itr != state.snapshots.begin() && ea < (*(itr - 1))->end_ea) {
+        state.last_snapshot = (itr - 1)->get();
+        return state.last_snapshot;
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+
+    segment_t* seg = getseg(ea);
+    if (seg == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr< TilegxSegmentSnapshot > snapshot(new TilegxSegmentSnapshot());
+    snapshot->start_ea = seg->start_ea & ~7;
+    snapshot->end_ea = (seg->end_ea + 7) & ~7;
+    snapshot->byte_buf.resize(snapshot->end_ea - snapshot->start_ea);
+    snapshot->mask_buf.resize(snapshot->byte_buf.size() / TILEGX_BUNDLE_SIZE);
+    snapshot->bytes = snapshot->byte_buf.data();
+    snapshot->mask = snapshot->mask_buf.data();
+    read_snapshot(snapshot.get(), snapshot->start_ea, snapshot->end_ea);
+    tilegx_cache_add_snapshot(snapshot->memory_size());
+
+    state.last_snapshot = snapshot.get();
+    state.snapshots.insert(itr, std::move(snapshot));
+    return state.last_snapshot;
+}
+
+} //namespace
+
+static inline uint64_t load_bundle(const uint8_t* bytes)
+{
+    //Bundles are always stored little endian
+    uint64_t bits = 0;
+    for (int i = TILEGX_BUNDLE_SIZE - 1; i >= 0; --i) {
+        bits = (bits << 8) | bytes[i];
+    }
+    return bits;
+}
+
+bool tilegx_snapshot_read(const TilegxSnapshot& snapshot, ea_t bundle_ea, uint64_t& bits)
+{
+    size_t offset = bundle_ea - snapshot.start_ea;
+    if (snapshot.mask[offset / TILEGX_BUNDLE_SIZE] != 0xff) {
+        return false;
+    }
+
+    bits = load_bundle(snapshot.bytes + offset);
+    return true;
+}
+
+bool tilegx_read_bundle(ea_t bundle_ea, uint64_t& bits)
+{
+    const TilegxSegmentSnapshot* snapshot = find_snapshot(bundle_ea, true);
+    if (snapshot) {
+        return tilegx_snapshot_read(*snapshot, bundle_ea, bits);
+    }
+
+    uint8_t bytes[TILEGX_BUNDLE_SIZE];
+    if (get_bytes(bytes, sizeof(bytes), bundle_ea) != sizeof(bytes)) {
+        return false;
+    }
+
+    bits = load_bundle(bytes);
+    return true;
+}
+
+const TilegxSnapshot* tilegx_snapshot(ea_t ea)
+{
+    return find_snapshot(ea, true);
+}
+
+void tilegx_snapshot_refresh(ea_t start_ea, ea_t end_ea)
+{
+    TilegxSnapshotState& state = snapshot_state();
+    for (const std::unique_ptr< TilegxSegmentSnapshot >& snapshot : state.snapshots) {
+        ea_t start = std::max(start_ea & ~7, snapshot->start_ea);
+        ea_t end = std::min((end_ea + 7) & ~7, snapshot->end_ea);
+        if (start < end) {
+            read_snapshot(snapshot.get(), start, end);
+        }
+    }
+}
+
+void tilegx_snapshot_invalidate(ea_t start_ea, ea_t end_ea)
+{
+    TilegxSnapshotState& state = snapshot_state();
+    state.last_snapshot = nullptr;
+    state.snapshots.erase(std::remove_if(state.snapshots.begin(), state.snapshots.end(),
+        [start_ea, end_ea](const std::unique_ptr< TilegxSegmentSnapshot >& snapshot) {
+            if (snapshot->start_ea < end_ea && snapshot->end_ea > start_ea) {
+                tilegx_cache_remove_snapshot(snapshot->memory_size());
+                return true;
+            }
+            return false;
+        }), state.snapshots.end());
+}
+
+void tilegx_snapshot_clear()
+{
+    TilegxSnapshotState& state = snapshot_state();
+    for (const std::unique_ptr< TilegxSegmentSnapshot >& snapshot : state.snapshots) {
+        tilegx_cache_remove_snapshot(snapshot->memory_size());
+    }
+    state.last_snapshot = nullptr;
+    state.snapshots.clear();
+}
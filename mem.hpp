@@ -0,0 +1,75 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_MEM_HPP
+#define _TILEGX_MEM_HPP
+
+#include <idp.hpp>
+
+/**
+ * The decoder reads bundles from a snapshot of the segment bytes, taken
+ * with one get_bytes() call when the segment is first decoded. Patches
+ * refresh the snapshot, segment changes drop it. Snapshots count against
+ * the budget of the bundle cache (see cache.hpp).
+ */
+
+/**
+ * Snapshot of the bytes of a segment, starting at the bundle that contains
+ * the segment start. Bytes without a value read as 0xff.
+ */
+struct TilegxSnapshot
+{
+    ea_t start_ea;
+    ea_t end_ea;
+    const uint8_t* bytes;
+    const uint8_t* mask; //One byte per bundle, 0xff if all its bytes have a value
+};
+
+/**
+ * Read the bundle at bundle_ea as little endian word
+ *
+ * @return false if not all bytes of the bundle have a value
+ */
+bool tilegx_read_bundle(ea_t bundle_ea, uint64_t& bits);
+
+/**
+ * Read the bundle at bundle_ea, which must be in the snapshot. Only reads
+ * the snapshot, so it can be used from any thread while the snapshot is
+ * alive.
+ *
+ * @return false if not all bytes of the bundle have a value
+ */
+bool tilegx_snapshot_read(const TilegxSnapshot& snapshot, ea_t bundle_ea, uint64_t& bits);
+
+/**
+ * @return Snapshot of the segment that contains ea, taken now if there is
+ *         none yet, or nullptr if ea is not in a segment
+ */
+const TilegxSnapshot* tilegx_snapshot(ea_t ea);
+
+/**
+ * Read [start_ea, end_ea) into the snapshots again
+ */
+void tilegx_snapshot_refresh(ea_t start_ea, ea_t end_ea);
+
+/**
+ * Drop the snapshots that overlap [start_ea, end_ea)
+ */
+void tilegx_snapshot_invalidate(ea_t start_ea, ea_t end_ea);
+
+void tilegx_snapshot_clear();
+
+#endif /* _TILEGX_MEM_HPP */
@@ -0,0 +1,144 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "opt.hpp"
+#include "ctx.hpp"
+#include "cache.hpp"
+
+//stdlib imports
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+//IDA Pro imports
+#include <kernwin.hpp>
+
+static const size_t MB = 1024 * 1024;
+
+const TilegxOptions TILEGX_DEFAULT_OPTIONS = {
+    false, //predecode
+    false, //background
+    0,     //threads
+    64,    //lookahead
+    false, //bundle_items
+};
+
+static const char* const OPTION_KEYWORDS[] = {
+    "TILEGX_CACHE_MB",
+    "TILEGX_PREDECODE",
+    "TILEGX_BACKGROUND",
+    "TILEGX_THREADS",
+    "TILEGX_LOOKAHEAD",
+    "TILEGX_BUNDLE_ITEMS",
+};
+
+static bool set_option(const char* keyword, uint64_t value)
+{
+    TilegxOptions& options = tilegx_context().options;
+
+    if (strcmp(keyword, "TILEGX_CACHE_MB") == 0) {
+        tilegx_cache_set_budget(value * MB);
+    }
+    else if (strcmp(keyword, "TILEGX_PREDECODE") == 0) {
+        options.predecode = value != 0;
+    }
+    else if (strcmp(keyword, "TILEGX_BACKGROUND") == 0) {
+        options.background = value != 0;
+    }
+    else if (strcmp(keyword, "TILEGX_THREADS") == 0) {
+        options.threads = static_cast<unsigned>(value);
+    }
+    else if (strcmp(keyword, "TILEGX_LOOKAHEAD") == 0) {
+        options.lookahead = static_cast<unsigned>(value);
+    }
+    else if (strcmp(keyword, "TILEGX_BUNDLE_ITEMS") == 0) {
+        options.bundle_items = value != 0;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+void tilegx_init_options()
+{
+    for (const char* keyword : OPTION_KEYWORDS) {
+        qstring value;
+        if (qgetenv(keyword, &value)) {
+            set_option(keyword, strtoull(value.c_str(), nullptr, 0));
+        }
+    }
+}
+
+ssize_t tilegx_set_idp_options(const char* keyword, int value_type, const void* value, const char** errbuf, bool idb_loaded)
+{
+    if (keyword == nullptr) {
+        const TilegxOptions& options = tilegx_context().options;
+        const TilegxCacheStats& stats = tilegx_cache_stats();
+        sval_t budget_mb = tilegx_cache_budget() / MB;
+        sval_t threads = options.threads;
+        sval_t lookahead = options.lookahead;
+        ushort flags = (options.predecode ? 1 : 0) | (options.background ? 2 : 0) | (options.bundle_items ? 4 : 0);
+
+        qstring form;
+        form.sprnt("Tile-GX options\n\n"
+                   "Decoded bundles: %" FMT_64 "u KB resident, %" FMT_64 "u chunks evicted\n"
+                   "Segment snapshots: %" FMT_64 "u KB\n"
+                   "Identical bundles: %" FMT_64 "u of %" FMT_64 "u decodes were cache hits\n"
+                   "Lookahead: %" FMT_64 "u of %" FMT_64 "u bundles decoded ahead were used\n\n"
+                   "<Decode cache budget in MB (0 for no limit):D:10:10::>\n"
+                   "<Bundles decoded ahead of sequential misses (0 to disable):D:10:10::>\n"
+                   "<Decoder threads (0 for one per core):D:10:10::>\n"
+                   "<Decode code segments of new files in advance:C>\n"
+                   "<Decode code segments of new files in the background:C>\n"
+                   "<One item per bundle (for code analyzed from now on):C>>\n",
+                   stats.resident_bytes / 1024, stats.evictions,
+                   stats.snapshot_bytes / 1024,
+                   stats.word_hits, stats.word_hits + stats.word_misses,
+                   stats.lookahead_hits, stats.lookahead_decoded);
+        if (ask_form(form.c_str(), &budget_mb, &lookahead, &threads, &flags) > 0) {
+            set_option("TILEGX_CACHE_MB", std::max< sval_t >(budget_mb, 0));
+            set_option("TILEGX_LOOKAHEAD", std::max< sval_t >(lookahead, 0));
+            set_option("TILEGX_THREADS", std::max< sval_t >(threads, 0));
+            set_option("TILEGX_PREDECODE", flags & 1);
+            set_option("TILEGX_BACKGROUND", flags & 2);
+            set_option("TILEGX_BUNDLE_ITEMS", flags & 4);
+        }
+        return 1;
+    }
+
+    bool known = false;
+    for (const char* option : OPTION_KEYWORDS) {
+        known |= strcmp(keyword, option) == 0;
+    }
+    if (!known) {
+        if (errbuf) {
+            *errbuf = IDPOPT_BADKEY;
+        }
+        return -1;
+    }
+
+    if (value_type != IDPOPT_NUM) {
+        if (errbuf) {
+            *errbuf = IDPOPT_BADTYPE;
+        }
+        return -1;
+    }
+
+    set_option(keyword, *static_cast<const uval_t*>(value));
+    return 1;
+}
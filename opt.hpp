@@ -0,0 +1,51 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_OPT_HPP
+#define _TILEGX_OPT_HPP
+
+#include <idp.hpp>
+
+struct TilegxOptions
+{
+    bool predecode;   //Decode all code segments when a new file is loaded
+    bool background;  //Decode code segments of new files on background threads during the analysis
+    unsigned threads; //Decoder threads, 0 for one per hardware thread
+    unsigned lookahead; //Most bundles decoded ahead of sequential cache misses, 0 to disable
+    bool bundle_items;  //One item per bundle instead of one per slot
+};
+
+extern const TilegxOptions TILEGX_DEFAULT_OPTIONS;
+
+/**
+ * Read the options from the environment:
+ * TILEGX_CACHE_MB   Memory budget of the decoded bundle cache in MB, 0 for no limit
+ * TILEGX_PREDECODE  1 to decode all code segments when a new file is loaded
+ * TILEGX_BACKGROUND 1 to decode code segments of new files on background threads
+ * TILEGX_THREADS    Decoder threads, 0 for one per hardware thread
+ * TILEGX_LOOKAHEAD  Most bundles decoded ahead of sequential cache misses, 0 to disable
+ * TILEGX_BUNDLE_ITEMS 1 to make every bundle one item instead of one per slot
+ */
+void tilegx_init_options();
+
+/**
+ * Handler for ev_set_idp_options. Understands the same keywords as the
+ * environment variables in a .cfg file, and shows the options dialog when
+ * keyword is NULL.
+ */
+ssize_t tilegx_set_idp_options(const char* keyword, int value_type, const void* value, const char** errbuf, bool idb_loaded);
+
+#endif /* _TILEGX_OPT_HPP */
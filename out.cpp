@@ -18,9 +18,36 @@
 #include "log.hpp"
 #include "ins.hpp"
 #include "reg.hpp"
+#include "ana.hpp"
 
 #include <name.hpp>
 
+/**
+ * Output the operands of a slot of the item, separated by commas
+ *
+ * @param space Put a space before the operands, if there are any
+ */
+static void out_slot_operands(outctx_t* ctx, unsigned slot, bool space)
+{
+	auto &cmd = ctx->insn;
+
+	bool first = true;
+	for (int n = 0; n < UA_MAXOP; ++n) {
+		if (cmd.ops[n].type == o_void || static_cast<unsigned>(cmd.ops[n].specflag1) != slot) {
+			continue;
+		}
+		if (!first) {
+			ctx->out_symbol(',');
+			ctx->out_char(' ');
+		}
+		else if (space) {
+			ctx->out_char(' ');
+		}
+		ctx->out_one_operand(n);
+		first = false;
+	}
+}
+
 ssize_t tilegx_out_insn(outctx_t* ctx)
 {
 	auto &cmd = ctx->insn;
@@ -29,35 +56,29 @@ ssize_t tilegx_out_insn(outctx_t* ctx)
 	//init_output_buffer(buf, sizeof(buf));
 	log("out(%08" FMT_EA "x)\n", cmd.ea);
 
-	//Output symbol to indicate that the instruction is in the same packet
-	if (cmd.ea & 7) {
-		ctx->out_char('+');
-	}
-
-	ctx->out_mnemonic();
-
-	int16_t feature = INSTRUCTIONS[cmd.itype].feature;
-
-	if (feature & (CF_CHG1 | CF_USE1)) {
-		ctx->out_one_operand(0);
-	}
-
-	if (feature & (CF_CHG2 | CF_USE2)) {
-		ctx->out_symbol(',');
+	if (cmd.size == 8 && tilegx_item_slots(cmd) > 1) {
+		//Whole bundle
+		ctx->out_symbol('{');
+		for (unsigned slot = 0; slot < tilegx_item_slots(cmd); ++slot) {
+			if (slot) {
+				ctx->out_char(' ');
+				ctx->out_symbol(';');
+			}
+			ctx->out_char(' ');
+			ctx->out_line(INSTRUCTIONS[tilegx_item_itype(cmd, slot)].name, COLOR_INSN);
+			out_slot_operands(ctx, slot, true);
+		}
 		ctx->out_char(' ');
-		ctx->out_one_operand(1);
-	}
-
-	if (feature & (CF_CHG3 | CF_USE3)) {
-		ctx->out_symbol(',');
-		ctx->out_char(' ');
-		ctx->out_one_operand(2);
+		ctx->out_symbol('}');
 	}
+	else {
+		//Output symbol to indicate that the instruction is in the same packet
+		if (cmd.ea & 7) {
+			ctx->out_char('+');
+		}
 
-	if (feature & (CF_CHG4 | CF_USE4)) {
-		ctx->out_symbol(',');
-		ctx->out_char(' ');
-		ctx->out_one_operand(3);
+		ctx->out_mnemonic();
+		out_slot_operands(ctx, 0, false);
 	}
 
 	//term_output_buffer();
@@ -67,6 +88,7 @@ ssize_t tilegx_out_insn(outctx_t* ctx)
 	//MakeLine(buf, -1);
 	ctx->out_immchar_cmts();
 	ctx->flush_outbuf();
+	return 1;
 }
 
 ssize_t tilegx_out_operand(outctx_t* ctx, const op_t* op)
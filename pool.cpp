@@ -0,0 +1,119 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "pool.hpp"
+
+//stdlib imports
+#include <algorithm>
+
+TilegxWorkPool::TilegxWorkPool(unsigned num_threads) : cancelled_(false), done_(0), num_items_(0)
+{
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < num_threads; ++i) {
+        queues_.emplace_back(new Queue());
+    }
+}
+
+TilegxWorkPool::~TilegxWorkPool()
+{
+    cancel();
+    join();
+}
+
+void TilegxWorkPool::start(size_t num_items, std::function< void(size_t) > work)
+{
+    join();
+
+    work_ = std::move(work);
+    cancelled_ = false;
+    done_ = 0;
+    num_items_ = num_items;
+
+    //Contiguous ranges per worker, neighbouring items tend to cost the same
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        std::lock_guard< std::mutex > lock(queues_[i]->mutex);
+        queues_[i]->items.clear();
+        for (size_t item = num_items * i / queues_.size(); item < num_items * (i + 1) / queues_.size(); ++item) {
+            queues_[i]->items.push_back(item);
+        }
+    }
+
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        threads_.emplace_back(&TilegxWorkPool::run, this, i);
+    }
+}
+
+void TilegxWorkPool::cancel()
+{
+    cancelled_ = true;
+}
+
+bool TilegxWorkPool::wait_for(std::chrono::milliseconds timeout)
+{
+    std::unique_lock< std::mutex > lock(done_mutex_);
+    return done_cond_.wait_for(lock, timeout, [this]() {
+        return done_ == num_items_;
+    });
+}
+
+bool TilegxWorkPool::next_item(size_t worker, size_t& item)
+{
+    {
+        Queue& own = *queues_[worker];
+        std::lock_guard< std::mutex > lock(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        Queue& victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard< std::mutex > lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TilegxWorkPool::run(size_t worker)
+{
+    size_t item;
+    while (!cancelled_ && next_item(worker, item)) {
+        work_(item);
+
+        std::lock_guard< std::mutex > lock(done_mutex_);
+        ++done_;
+        done_cond_.notify_all();
+    }
+}
+
+void TilegxWorkPool::join()
+{
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
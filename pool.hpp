@@ -0,0 +1,95 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_POOL_HPP
+#define _TILEGX_POOL_HPP
+
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work stealing thread pool for a fixed set of work items. The items are
+ * dealt out to the workers up front; a worker that runs out of items takes
+ * them from the back of another worker's queue.
+ */
+class TilegxWorkPool
+{
+public:
+    /**
+     * @param num_threads Number of workers, 0 for one per hardware thread
+     */
+    explicit TilegxWorkPool(unsigned num_threads);
+    ~TilegxWorkPool();
+
+    /**
+     * Run work(item) for all items in [0, num_items). Returns immediately,
+     * work is called from the worker threads.
+     */
+    void start(size_t num_items, std::function< void(size_t) > work);
+
+    /**
+     * Make the workers stop after their current item. Destroying the pool
+     * waits for that.
+     */
+    void cancel();
+
+    /**
+     * Wait until all items are done or the timeout expires
+     *
+     * @return true if all items are done
+     */
+    bool wait_for(std::chrono::milliseconds timeout);
+
+    size_t num_done() const {
+        return done_;
+    }
+
+    unsigned num_threads() const {
+        return static_cast<unsigned>(queues_.size());
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque< size_t > items;
+    };
+
+    bool next_item(size_t worker, size_t& item);
+    void run(size_t worker);
+    void join();
+
+    std::vector< std::unique_ptr< Queue > > queues_;
+    std::vector< std::thread > threads_;
+    std::function< void(size_t) > work_;
+    std::atomic< bool > cancelled_;
+    std::atomic< size_t > done_;
+    size_t num_items_;
+
+    std::mutex done_mutex_;
+    std::condition_variable done_cond_;
+};
+
+#endif /* _TILEGX_POOL_HPP */
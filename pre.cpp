@@ -0,0 +1,383 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "pre.hpp"
+#include "ctx.hpp"
+#include "pool.hpp"
+#include "ring.hpp"
+#include "mem.hpp"
+#include "cache.hpp"
+#include "log.hpp"
+
+//stdlib imports
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//IDA Pro imports
+#include <kernwin.hpp>
+#include <segment.hpp>
+
+//Bundles per work item
+static const size_t BLOCK_BUNDLES = 4096;
+
+struct TilegxPredecodeBlock
+{
+    const TilegxSnapshot* snapshot;
+    ea_t start_ea;
+    size_t num_bundles;
+    std::unique_ptr< TilegxBundle[] > bundles;
+    bool reserved; //Counted against the cache budget until it is inserted
+};
+
+static size_t block_bytes(const TilegxPredecodeBlock& block)
+{
+    return block.num_bundles * sizeof(TilegxBundle);
+}
+
+static void decode_block(TilegxPredecodeBlock& block)
+{
+    block.bundles.reset(new TilegxBundle[block.num_bundles]());
+    for (size_t i = 0; i < block.num_bundles; ++i) {
+        uint64_t bits;
+        if (tilegx_snapshot_read(*block.snapshot, block.start_ea + i * TILEGX_BUNDLE_SIZE, bits)) {
+            tilegx_build_bundle(bits, block.bundles[i]);
+        }
+    }
+}
+
+static void insert_block(TilegxPredecodeBlock& block)
+{
+    tilegx_cache_release(block_bytes(block));
+    block.reserved = false;
+
+    for (size_t i = 0; i < block.num_bundles; ++i) {
+        TilegxBundle* cached = tilegx_cache_insert(block.start_ea + i * TILEGX_BUNDLE_SIZE);
+        if (cached) {
+            *cached = block.bundles[i];
+        }
+    }
+    block.bundles.reset();
+}
+
+/**
+ * Split the code segments into blocks, up to what is left of the cache
+ * budget. Blocks that are cached already are left out. The blocks are
+ * reserved in the cache, so that the cache and the blocks the workers hold
+ * together stay within the budget.
+ */
+static std::vector< TilegxPredecodeBlock > plan_blocks()
+{
+    std::vector< TilegxPredecodeBlock > blocks;
+    bool limited = tilegx_cache_budget() != 0;
+    size_t available = tilegx_cache_available();
+    size_t planned = 0;
+    ea_t planned_end = 0; //Segments that do not end on a bundle share one with the next
+
+    for (segment_t* seg = get_first_seg(); seg != nullptr; seg = get_next_seg(seg->start_ea)) {
+        if (seg->type != SEG_CODE) {
+            continue;
+        }
+
+        for (ea_t ea = std::max(seg->start_ea & ~7, planned_end); ea < seg->end_ea; ea = planned_end) {
+            //The first bundle can be in the snapshot of the previous segment, so
+            //blocks end where their snapshot does
+            const TilegxSnapshot* snapshot = tilegx_snapshot(std::max(ea, seg->start_ea));
+            if (snapshot == nullptr) {
+                break;
+            }
+
+            ea_t end_ea = std::min(seg->end_ea, snapshot->end_ea);
+            size_t num_bundles = std::min< size_t >(BLOCK_BUNDLES, (end_ea - ea + 7) / TILEGX_BUNDLE_SIZE);
+            planned_end = ea + num_bundles * TILEGX_BUNDLE_SIZE;
+            if (tilegx_cache_contains(ea, num_bundles)) {
+                continue;
+            }
+
+            TilegxPredecodeBlock block {snapshot, ea, num_bundles, nullptr, true};
+            if (limited && planned + block_bytes(block) > available) {
+                tilegx_cache_reserve(planned);
+                return blocks;
+            }
+            planned += block_bytes(block);
+            blocks.push_back(std::move(block));
+        }
+    }
+
+    tilegx_cache_reserve(planned);
+    return blocks;
+}
+
+/**
+ * @return Bytes of the blocks that were not inserted. Only the main thread
+ *         touches the reserved flags.
+ */
+static size_t reserved_bytes(const std::vector< TilegxPredecodeBlock >& blocks)
+{
+    size_t bytes = 0;
+    for (const TilegxPredecodeBlock& block : blocks) {
+        if (block.reserved) {
+            bytes += block_bytes(block);
+        }
+    }
+    return bytes;
+}
+
+void tilegx_predecode()
+{
+    std::vector< TilegxPredecodeBlock > blocks = plan_blocks();
+    if (blocks.empty()) {
+        return;
+    }
+
+    //Workers only read the snapshots and write their own block, the cache
+    //is filled on this thread
+    std::mutex finished_mutex;
+    std::vector< size_t > finished;
+    std::unique_ptr< TilegxWorkPool > pool(new TilegxWorkPool(tilegx_context().options.threads));
+    pool->start(blocks.size(), [&](size_t item) {
+        decode_block(blocks[item]);
+
+        std::lock_guard< std::mutex > lock(finished_mutex);
+        finished.push_back(item);
+    });
+
+    auto insert_finished = [&]() {
+        std::vector< size_t > items;
+        {
+            std::lock_guard< std::mutex > lock(finished_mutex);
+            items.swap(finished);
+        }
+        for (size_t item : items) {
+            insert_block(blocks[item]);
+        }
+    };
+
+    show_wait_box("Decoding bundles on %u threads", pool->num_threads());
+    while (!pool->wait_for(std::chrono::milliseconds(100))) {
+        insert_finished();
+        replace_wait_box("Decoding bundles on %u threads: %u%%", pool->num_threads(),
+                         static_cast<unsigned>(pool->num_done() * 100 / blocks.size()));
+        if (user_cancelled()) {
+            pool->cancel();
+            break;
+        }
+    }
+    hide_wait_box();
+
+    //Wait for the workers, and keep what they finished
+    pool.reset();
+    insert_finished();
+    tilegx_cache_release(reserved_bytes(blocks));
+    log("predecoded %u blocks\n", static_cast<unsigned>(blocks.size()));
+}
+
+namespace {
+
+/**
+ * Decodes the blocks on background threads. Each worker claims the free
+ * block nearest behind the address the analysis last missed, and hands
+ * finished blocks to the main thread through its own ring.
+ */
+struct TilegxBackgroundDecoder : TilegxContextPart
+{
+    struct Worker
+    {
+        std::thread thread;
+        TilegxRing< size_t, 64 > finished;
+    };
+
+    std::vector< TilegxPredecodeBlock > blocks;
+    std::unique_ptr< std::atomic< bool >[] > claimed;
+    std::vector< std::unique_ptr< Worker > > workers;
+    std::atomic< ea_t > hint;
+    std::atomic< bool > stopped;
+    std::atomic< size_t > num_exited;
+    bool paused = false; //Workers stopped for a change, started again on the next collect
+
+    ~TilegxBackgroundDecoder();
+
+    bool claim_block(size_t& item);
+    void run(Worker& worker);
+    void join();
+    void insert_finished();
+};
+
+TilegxBackgroundDecoder::~TilegxBackgroundDecoder()
+{
+    join();
+}
+
+void TilegxBackgroundDecoder::join()
+{
+    stopped = true;
+    for (const std::unique_ptr< Worker >& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void TilegxBackgroundDecoder::insert_finished()
+{
+    for (const std::unique_ptr< Worker >& worker : workers) {
+        size_t item;
+        while (worker->finished.pop(item)) {
+            insert_block(blocks[item]);
+        }
+    }
+}
+
+bool TilegxBackgroundDecoder::claim_block(size_t& item)
+{
+    //Start at the block that contains the hint and wrap around
+    ea_t ea = hint.load(std::memory_order_relaxed);
+    auto itr = std::upper_bound(blocks.begin(), blocks.end(), ea,
+        [](ea_t addr, const TilegxPredecodeBlock& block) {
+            return addr < block.start_ea;
+        });
+    size_t first = itr == blocks.begin() ? 0 : itr - blocks.begin() - 1;
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        size_t idx = (first + i) % blocks.size();
+        if (!claimed[idx].load(std::memory_order_relaxed) && !claimed[idx].exchange(true)) {
+            item = idx;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TilegxBackgroundDecoder::run(Worker& worker)
+{
+    size_t item;
+    while (!stopped && claim_block(item)) {
+        decode_block(blocks[item]);
+
+        //The main thread only empties the rings while it analyzes
+        while (!worker.finished.push(item)) {
+            if (stopped) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    num_exited.fetch_add(1, std::memory_order_release);
+}
+
+TilegxBackgroundDecoder* get_background()
+{
+    return static_cast<TilegxBackgroundDecoder*>(tilegx_context().background.get());
+}
+
+} //namespace
+
+void tilegx_background_start()
+{
+    tilegx_background_stop();
+
+    std::vector< TilegxPredecodeBlock > blocks = plan_blocks();
+    if (blocks.empty()) {
+        return;
+    }
+
+    //Leave one core to IDA
+    unsigned num_threads = tilegx_context().options.threads;
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    TilegxBackgroundDecoder* background = new TilegxBackgroundDecoder();
+    tilegx_context().background.reset(background);
+    background->blocks = std::move(blocks);
+    background->claimed.reset(new std::atomic< bool >[background->blocks.size()]());
+    background->hint = 0;
+    background->stopped = false;
+    background->num_exited = 0;
+    for (unsigned i = 0; i < num_threads; ++i) {
+        background->workers.emplace_back(new TilegxBackgroundDecoder::Worker());
+    }
+    for (const std::unique_ptr< TilegxBackgroundDecoder::Worker >& worker : background->workers) {
+        worker->thread = std::thread(&TilegxBackgroundDecoder::run, background, std::ref(*worker));
+    }
+    log("background decoding of %u blocks on %u threads\n",
+        static_cast<unsigned>(background->blocks.size()), num_threads);
+}
+
+void tilegx_background_collect()
+{
+    TilegxBackgroundDecoder* background = get_background();
+    if (background == nullptr) {
+        return;
+    }
+
+    //Continue with what the change left to decode, where the analysis is
+    if (background->paused) {
+        ea_t hint = background->hint.load(std::memory_order_relaxed);
+        tilegx_background_start();
+        tilegx_background_hint(hint);
+        return;
+    }
+
+    //Everything pushed before the workers exited is in the rings now
+    bool exited = background->num_exited.load(std::memory_order_acquire) == background->workers.size();
+    background->insert_finished();
+
+    if (exited) {
+        tilegx_background_stop();
+    }
+}
+
+void tilegx_background_hint(ea_t ea)
+{
+    TilegxBackgroundDecoder* background = get_background();
+    if (background) {
+        background->hint.store(ea, std::memory_order_relaxed);
+    }
+}
+
+void tilegx_background_pause()
+{
+    TilegxBackgroundDecoder* background = get_background();
+    if (background == nullptr || background->paused) {
+        return;
+    }
+
+    //Keep what is finished, the change invalidates what it affects
+    background->join();
+    background->insert_finished();
+    tilegx_cache_release(reserved_bytes(background->blocks));
+    background->workers.clear();
+    background->blocks.clear();
+    background->claimed.reset();
+    background->paused = true;
+}
+
+void tilegx_background_stop()
+{
+    TilegxBackgroundDecoder* background = get_background();
+    if (background == nullptr) {
+        return;
+    }
+
+    //Joins the workers and drops the blocks that were not collected
+    size_t reserved = reserved_bytes(background->blocks);
+    tilegx_context().background.reset();
+    tilegx_cache_release(reserved);
+}
@@ -0,0 +1,61 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_PRE_HPP
+#define _TILEGX_PRE_HPP
+
+#include <idp.hpp>
+
+/**
+ * Decode all code segments on a thread pool into the bundle cache, so that
+ * the analysis afterwards only looks bundles up. Stops at the cache budget.
+ * Shows progress in a wait box and can be cancelled.
+ */
+void tilegx_predecode();
+
+/**
+ * Decode the code segments on background threads while the analysis runs.
+ * The workers start near the address of the last cache miss, see
+ * tilegx_background_hint, and stop at the cache budget. The bundles reach
+ * the cache on tilegx_background_collect, which never waits for them.
+ */
+void tilegx_background_start();
+
+/**
+ * Move the bundles decoded so far into the cache, or start the workers
+ * again after tilegx_background_pause. Called by ana.
+ */
+void tilegx_background_collect();
+
+/**
+ * Tell the workers where the analysis needs bundles next
+ */
+void tilegx_background_hint(ea_t ea);
+
+/**
+ * Stop the workers before the segment snapshots change. What they finished
+ * goes into the cache, the rest is dropped. The next collect starts them
+ * again over the bundles that are not cached, so the change has to
+ * invalidate what it affects before that.
+ */
+void tilegx_background_pause();
+
+/**
+ * Stop the workers and drop what was not collected yet
+ */
+void tilegx_background_stop();
+
+#endif /* _TILEGX_PRE_HPP */
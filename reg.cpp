@@ -14,15 +14,24 @@
   * limitations under the License.
   */
 
+#include <ctype.h>
 #include <functional>
 
 #include <idp.hpp>
+#include <diskio.hpp>
 #include "reg.hpp"
 #include "ins.hpp"
 #include "ana.hpp"
 #include "emu.hpp"
 #include "out.hpp"
 #include "log.hpp"
+#include "opt.hpp"
+#include "ctx.hpp"
+#include "idb.hpp"
+#include "pre.hpp"
+#include "scan.hpp"
+#include "diag.hpp"
+#include "hash.hpp"
 
 
 #define PLFM_TILEGX 0x8369
@@ -124,12 +133,12 @@ template<typename ReturnType, typename TA1, typename TA2, typename TA3, typename
 /************************************************************************/
 /* Short names of processor                                             */
 /************************************************************************/
-static const char *const SHORT_PROCESSOR_NAMES[] = { "tilegx", NULL };
+static const char *const SHORT_PROCESSOR_NAMES[] = { "tilegx", "tilegx32", NULL };
 
 /************************************************************************/
 /* Long names of processor                                              */
 /************************************************************************/
-static const char *const LONG_PROCESSOR_NAMES[] = { "Tilera Tile-GX", NULL };
+static const char *const LONG_PROCESSOR_NAMES[] = { "Tilera Tile-GX", "Tilera Tile-GX (32 bit ABI)", NULL };
 
 /************************************************************************/
 /* Definition of Tile-GX assembler                                      */
@@ -201,7 +210,7 @@ asm_t *asms[]       = { &gas, NULL };
 /************************************************************************/
 /* Register names                                                       */
 /************************************************************************/
-const char *const REGISTER_NAMES[] =
+constexpr const char *REGISTER_NAMES[] =
 {
     "r0",  "r1",  "r2",  "r3",  "r4",  "r5",  "r6",  "r7",  "r8",  "r9",
     "r10", "r11", "r12", "r13", "r14", "r15", "r16", "r17", "r18", "r19",
@@ -219,7 +228,51 @@ const char *const REGISTER_NAMES[] =
     "CS", "DS"
 };
 
-const size_t NUM_REGISTER_NAMES = sizeof(REGISTER_NAMES) / sizeof(REGISTER_NAMES[0]);
+constexpr size_t NUM_REGISTER_NAMES = sizeof(REGISTER_NAMES) / sizeof(REGISTER_NAMES[0]);
+
+//General purpose registers that are named rN, the rest have aliases
+static constexpr int NUM_NUMBERED_REGISTERS = 54;
+
+static constexpr std::string_view register_name(size_t idx)
+{
+    return REGISTER_NAMES[idx];
+}
+
+static constexpr bool registers_are_numbered()
+{
+    for (int i = 0; i < NUM_NUMBERED_REGISTERS; ++i) {
+        std::string_view name = register_name(i);
+        int number = 0;
+        for (size_t j = 1; j < name.size(); ++j) {
+            number = number * 10 + (name[j] - '0');
+        }
+        if (name[0] != 'r' || number != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(registers_are_numbered(), "REGISTER_NAMES must start with r0 to r53");
+static_assert(register_name(TILEGX_REG_SP) == "sp" && register_name(TILEGX_REG_LR) == "lr", "sp and lr follow r53");
+
+static constexpr TilegxPerfectHash< NUM_REGISTER_NAMES, 2 * NUM_REGISTER_NAMES, NUM_REGISTER_NAMES / 2 > REGISTER_HASH(register_name);
+
+int tilegx_find_register(const char* name)
+{
+    //rN is by far the most common, its index is the number
+    if (name[0] == 'r' && isdigit(name[1])) {
+        if (name[2] == '\0') {
+            return name[1] - '0';
+        }
+        if (name[1] != '0' && isdigit(name[2]) && name[3] == '\0') {
+            int number = (name[1] - '0') * 10 + name[2] - '0';
+            return number < NUM_NUMBERED_REGISTERS ? number : -1;
+        }
+    }
+
+    return REGISTER_HASH.find(register_name, name);
+}
 
 /************************************************************************/
 /* File headers for Tile-GX assembler                                   */
@@ -244,19 +297,45 @@ ssize_t newfile(const char *fname)
     msg("based on objdump and hexagon plugin from Willem Jan Hengeveld <itsme@gsmk.de.\n");
     msg("\n");
 
+    if (tilegx_context().options.predecode) {
+        tilegx_predecode();
+    }
+    else if (tilegx_context().options.background) {
+        tilegx_background_start();
+    }
+
     return 1;
 }
 
 
 ssize_t is_sane_insn(const insn_t* cmd, int no_crefs)
 {
-    return cmd->itype != 0;
+    //IDA takes anything but a negative value as sane
+    if (cmd->itype == 0) {
+        return -1;
+    }
+
+    //Nothing refers to it, IDA is only guessing
+    if (no_crefs == 1 && !tilegx_likely_code(cmd->ea & ~7)) {
+        return -1;
+    }
+    return 1;
 }
 
 ssize_t loader_elf_machine(linput_t* li, int machine_type, const char **p_procname, proc_def_t **p_pd)
 {
     if (machine_type == 191) {
-        *p_procname = "tilegx";
+        //ELF32 files use the 32 bit ABI. The loader goes on reading from
+        //where it was.
+        uchar elf_class = 0;
+        qoff64_t pos = qltell(li);
+        if (qlseek(li, 4) == 4 && qlread(li, &elf_class, 1) == 1 && elf_class == 1) {
+            *p_procname = "tilegx32";
+        }
+        else {
+            *p_procname = "tilegx";
+        }
+        qlseek(li, pos);
     }
 
     return machine_type;
@@ -272,6 +351,31 @@ ssize_t loader_elf_machine(linput_t* li, int machine_type, const char **p_procna
 static ssize_t idaapi notify(void *, int msgid, va_list va)
 {
     switch (msgid) {
+        case processor_t::ev_init:
+            tilegx_create_context();
+            tilegx_init_options();
+            tilegx_hook_idb_events();
+            tilegx_register_diag_action();
+            return 0;
+        case processor_t::ev_term:
+            tilegx_unregister_diag_action();
+            tilegx_unhook_idb_events();
+            tilegx_destroy_context();
+            return 0;
+        case processor_t::ev_set_idp_options:
+        {
+            const char* keyword = va_arg(va, const char*);
+            int value_type = va_arg(va, int);
+            const void* value = va_arg(va, const void*);
+            const char** errbuf = va_arg(va, const char**);
+            bool idb_loaded = va_arg(va, int) != 0;
+            return tilegx_set_idp_options(keyword, value_type, value, errbuf, idb_loaded);
+        }
+        case processor_t::ev_newprc:
+            tilegx_context().processor = static_cast<TilegxProcessor>(va_arg(va, int));
+            return 1;
+        case processor_t::ev_newfile:
+            return invoke_variadic(&newfile, va);
         case processor_t::ev_ana_insn:
             return invoke_variadic(&tilegx_ana_insn, va);
         case processor_t::ev_emu_insn:
@@ -286,6 +390,17 @@ static ssize_t idaapi notify(void *, int msgid, va_list va)
             return invoke_variadic(&loader_elf_machine, va);
         case processor_t::ev_is_sane_insn:
             return invoke_variadic(&is_sane_insn, va);
+        case processor_t::ev_is_call_insn:
+            return invoke_variadic(&tilegx_is_call_insn, va);
+        case processor_t::ev_is_ret_insn:
+        {
+            const insn_t* insn = va_arg(va, const insn_t*);
+            bool strict = va_arg(va, int) != 0;
+            return tilegx_is_ret_insn(insn, strict);
+        }
+        case processor_t::ev_auto_queue_empty:
+            tilegx_diag_flush();
+            return 0;
         default:
             return 0;
     }
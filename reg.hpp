@@ -17,8 +17,26 @@
 #ifndef _TILEGX_REG_HPP
 #define _TILEGX_REG_HPP
 
+/**
+ * Processors of the module, in the order of the processor names
+ */
+enum TilegxProcessor
+{
+    TILEGX_PROCESSOR_TILEGX,   //64 bit ABI
+    TILEGX_PROCESSOR_TILEGX32  //32 bit ABI, addresses are 32 bit
+};
+
+//Registers with a role in the ABI, indices into REGISTER_NAMES
+static const int TILEGX_REG_SP = 54;
+static const int TILEGX_REG_LR = 55;
+
 extern char const* const REGISTER_NAMES[];
 extern const size_t NUM_REGISTER_NAMES;
 
+/**
+ * @return Index of the register in REGISTER_NAMES, or -1 if there is no
+ *         register with that name
+ */
+int tilegx_find_register(const char* name);
 
 #endif /* _TILEGX_REG_HPP */
@@ -0,0 +1,71 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_RING_HPP
+#define _TILEGX_RING_HPP
+
+#include <stddef.h>
+
+#include <atomic>
+
+/**
+ * Bounded lock free queue between exactly one producer and one consumer
+ * thread. Neither side ever blocks: push fails when the ring is full and
+ * pop when it is empty. Everything the producer wrote before a push is
+ * visible to the consumer after the matching pop.
+ */
+template< typename T, size_t Capacity >
+class TilegxRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    TilegxRing() : head_(0), tail_(0) {}
+
+    //Producer side
+    bool push(const T& item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        items_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //Consumer side
+    bool pop(T& item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        item = items_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    //On separate cache lines, each is written by one side only
+    alignas(64) std::atomic< size_t > head_;
+    alignas(64) std::atomic< size_t > tail_;
+    T items_[Capacity];
+};
+
+#endif /* _TILEGX_RING_HPP */
@@ -0,0 +1,459 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+//Our own imports
+#include "scan.hpp"
+#include "ctx.hpp"
+#include "dec.hpp"
+#include "ins.hpp"
+#include "mem.hpp"
+#include "bundle.hpp"
+
+//stdlib imports
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TILEGX_SCAN_X86
+#endif
+
+//IDA Pro imports
+#include <segment.hpp>
+
+namespace {
+
+const uint64_t BUNDLE_MODE_MASK = 3ULL << 62;
+
+//Bundles before and after a bundle that are taken into account, and how
+//many of them, in percent, have to look like code
+const size_t LIKELY_CODE_WINDOW = 16;
+const size_t LIKELY_CODE_PERCENT = 75;
+
+/**
+ * Encodings with the same mask, matched with one AND. X mode is part of the
+ * mask, Y mode (mode bits not zero) cannot be, so it is checked separately.
+ */
+struct TilegxScanGroup
+{
+    uint64_t mask;
+    bool y_mode;
+    size_t first; //Values and kinds in [first, last)
+    size_t last;
+};
+
+struct TilegxScanTable
+{
+    std::vector< TilegxScanGroup > groups;
+    std::vector< uint64_t > values;
+    std::vector< unsigned > kinds;
+};
+
+int opcode_scan_kind(TilegxOpcode opcode)
+{
+    const char* name = tilegx_opcode_name(opcode);
+    uint32_t feature = INSTRUCTIONS[tilegx_opcode_itype(opcode)].feature;
+
+    if (strncmp(name, "swint", 5) == 0) {
+        return TILEGX_SCAN_SWINT;
+    }
+    if (feature & CF_CALL) {
+        return TILEGX_SCAN_CALL;
+    }
+    if (strcmp(name, "jr") == 0 || strcmp(name, "jrp") == 0) {
+        return TILEGX_SCAN_INDIRECT;
+    }
+    if (feature & CF_JUMP) {
+        return TILEGX_SCAN_BRANCH;
+    }
+    if (feature & CF_STOP) {
+        return TILEGX_SCAN_STOP;
+    }
+    return -1;
+}
+
+TilegxScanTable build_scan_table()
+{
+    struct Encoding
+    {
+        uint64_t mask;
+        uint64_t value;
+        bool y_mode;
+        unsigned kind;
+    };
+
+    std::vector< Encoding > encodings;
+    for (unsigned opc = 0; opc < TILEGX_OPC_NONE; ++opc) {
+        int kind = opcode_scan_kind(static_cast<TilegxOpcode>(opc));
+        if (kind < 0) {
+            continue;
+        }
+
+        for (unsigned pipe = TILEGX_PIPELINE_X0; pipe <= TILEGX_PIPELINE_Y2; ++pipe) {
+            uint64_t mask;
+            uint64_t value;
+            if (tilegx_opcode_encoding(static_cast<TilegxOpcode>(opc), static_cast<TilegxPipeline>(pipe), mask, value)) {
+                bool y_mode = pipe >= TILEGX_PIPELINE_Y0;
+                encodings.push_back(Encoding {y_mode ? mask : mask | BUNDLE_MODE_MASK, value, y_mode, static_cast<unsigned>(kind)});
+            }
+        }
+    }
+
+    std::sort(encodings.begin(), encodings.end(), [](const Encoding& a, const Encoding& b) {
+        return a.y_mode != b.y_mode ? b.y_mode : a.mask < b.mask;
+    });
+
+    TilegxScanTable table;
+    for (const Encoding& encoding : encodings) {
+        if (table.groups.empty() || table.groups.back().mask != encoding.mask || table.groups.back().y_mode != encoding.y_mode) {
+            table.groups.push_back(TilegxScanGroup {encoding.mask, encoding.y_mode, table.values.size(), table.values.size()});
+        }
+        table.values.push_back(encoding.value);
+        table.kinds.push_back(encoding.kind);
+        ++table.groups.back().last;
+    }
+    return table;
+}
+
+const TilegxScanTable& scan_table()
+{
+    //Only depends on the instruction tables
+    static const TilegxScanTable table = build_scan_table();
+    return table;
+}
+
+void scan_scalar(const TilegxScanTable& table, const uint8_t* bytes, size_t first, size_t last, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS])
+{
+    for (size_t i = first; i < last; ++i) {
+        //IDA only runs on little endian hosts
+        uint64_t word;
+        memcpy(&word, bytes + i * TILEGX_BUNDLE_SIZE, sizeof(word));
+        bool y_mode = (word & BUNDLE_MODE_MASK) != 0;
+
+        for (const TilegxScanGroup& group : table.groups) {
+            if (group.y_mode && !y_mode) {
+                continue;
+            }
+            uint64_t fixed = word & group.mask;
+            for (size_t v = group.first; v < group.last; ++v) {
+                if (fixed == table.values[v]) {
+                    bitmaps[table.kinds[v]][i / 64] |= 1ULL << (i % 64);
+                }
+            }
+        }
+    }
+}
+
+#ifdef TILEGX_SCAN_X86
+
+/**
+ * @return Number of bundles scanned, a multiple of 4
+ */
+__attribute__((target("avx2")))
+size_t scan_avx2(const TilegxScanTable& table, const uint8_t* bytes, size_t num_bundles, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS])
+{
+    const __m256i mode_mask = _mm256_set1_epi64x(BUNDLE_MODE_MASK);
+    const __m256i zero = _mm256_setzero_si256();
+
+    //The matches of 64 bundles are collected in registers and stored at once
+    size_t i = 0;
+    while (i + 4 <= num_bundles) {
+        size_t first = i;
+        uint64_t found[TILEGX_NUM_SCAN_KINDS] = {};
+        for (unsigned shift = 0; shift < 64 && i + 4 <= num_bundles; shift += 4, i += 4) {
+            __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i * TILEGX_BUNDLE_SIZE));
+            __m256i x_mode = _mm256_cmpeq_epi64(_mm256_and_si256(words, mode_mask), zero);
+            uint64_t y_mode = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(x_mode))) & 0xf;
+
+            for (const TilegxScanGroup& group : table.groups) {
+                __m256i fixed = _mm256_and_si256(words, _mm256_set1_epi64x(group.mask));
+                uint64_t lanes = group.y_mode ? y_mode : 0xf;
+                for (size_t v = group.first; v < group.last; ++v) {
+                    __m256i match = _mm256_cmpeq_epi64(fixed, _mm256_set1_epi64x(table.values[v]));
+                    uint64_t bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(match)));
+                    found[table.kinds[v]] |= (bits & lanes) << shift;
+                }
+            }
+        }
+
+        for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+            bitmaps[kind][first / 64] |= found[kind];
+        }
+    }
+    return i;
+}
+
+/**
+ * @return Number of bundles scanned, a multiple of 2
+ */
+__attribute__((target("sse4.1")))
+size_t scan_sse41(const TilegxScanTable& table, const uint8_t* bytes, size_t num_bundles, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS])
+{
+    const __m128i mode_mask = _mm_set1_epi64x(BUNDLE_MODE_MASK);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    while (i + 2 <= num_bundles) {
+        size_t first = i;
+        uint64_t found[TILEGX_NUM_SCAN_KINDS] = {};
+        for (unsigned shift = 0; shift < 64 && i + 2 <= num_bundles; shift += 2, i += 2) {
+            __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * TILEGX_BUNDLE_SIZE));
+            __m128i x_mode = _mm_cmpeq_epi64(_mm_and_si128(words, mode_mask), zero);
+            uint64_t y_mode = ~static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(x_mode))) & 0x3;
+
+            for (const TilegxScanGroup& group : table.groups) {
+                __m128i fixed = _mm_and_si128(words, _mm_set1_epi64x(group.mask));
+                uint64_t lanes = group.y_mode ? y_mode : 0x3;
+                for (size_t v = group.first; v < group.last; ++v) {
+                    __m128i match = _mm_cmpeq_epi64(fixed, _mm_set1_epi64x(table.values[v]));
+                    uint64_t bits = static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(match)));
+                    found[table.kinds[v]] |= (bits & lanes) << shift;
+                }
+            }
+        }
+
+        for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+            bitmaps[kind][first / 64] |= found[kind];
+        }
+    }
+    return i;
+}
+
+#endif
+
+struct TilegxFlowMap
+{
+    ea_t start_ea; //Address of the first bundle
+    ea_t end_ea;
+    std::vector< uint64_t > bitmaps[TILEGX_NUM_SCAN_KINDS];
+    std::vector< uint64_t > likely_code; //Empty until first asked
+};
+
+struct TilegxFlowState : TilegxContextPart
+{
+    //Sorted by start_ea
+    std::vector< std::unique_ptr< TilegxFlowMap > > maps;
+    TilegxFlowMap* last_map = nullptr;
+};
+
+TilegxFlowState& flow_state()
+{
+    std::unique_ptr< TilegxContextPart >& part = tilegx_context().flow;
+    if (!part) {
+        part.reset(new TilegxFlowState());
+    }
+    return static_cast<TilegxFlowState&>(*part);
+}
+
+TilegxFlowMap* find_map(ea_t ea)
+{
+    TilegxFlowState& state = flow_state();
+    if (state.last_map && ea >= state.last_map->start_ea && ea < state.last_map->end_ea) {
+        return state.last_map;
+    }
+
+    auto itr = std::upper_bound(state.maps.begin(), state.maps.end(), ea,
+        [](ea_t addr, const std::unique_ptr< TilegxFlowMap >& map) {
+            return addr < map->start_ea;
+        });
+    if (itr != state.maps.begin() && ea < (*(itr - 1))->end_ea) {
+        state.last_map = (itr - 1)->get();
+        return state.last_map;
+    }
+
+    //Scan the snapshot of the segment
+    const TilegxSnapshot* snapshot = tilegx_snapshot(ea);
+    if (snapshot == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr< TilegxFlowMap > map(new TilegxFlowMap());
+    map->start_ea = snapshot->start_ea;
+    map->end_ea = snapshot->end_ea;
+
+    size_t num_bundles = (map->end_ea - map->start_ea) / TILEGX_BUNDLE_SIZE;
+    uint64_t* bitmaps[TILEGX_NUM_SCAN_KINDS];
+    for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+        map->bitmaps[kind].resize((num_bundles + 63) / 64);
+        bitmaps[kind] = map->bitmaps[kind].data();
+    }
+    tilegx_scan_bundles(snapshot->bytes, num_bundles, bitmaps);
+
+    //Bundles without a value are not code
+    for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+        for (size_t w = 0; w < map->bitmaps[kind].size(); ++w) {
+            for (uint64_t bits = map->bitmaps[kind][w]; bits; bits &= bits - 1) {
+                size_t idx = w * 64 + __builtin_ctzll(bits);
+                if (snapshot->mask[idx] != 0xff) {
+                    map->bitmaps[kind][w] &= ~(1ULL << (idx % 64));
+                }
+            }
+        }
+    }
+
+    state.last_map = map.get();
+    state.maps.insert(itr, std::move(map));
+    return state.last_map;
+}
+
+bool plausible_bundle(const TilegxSnapshot& snapshot, size_t idx)
+{
+    if (snapshot.mask[idx] != 0xff) {
+        return false;
+    }
+
+    //Fill patterns
+    const uint8_t* bytes = snapshot.bytes + idx * TILEGX_BUNDLE_SIZE;
+    uint64_t bits;
+    memcpy(&bits, bytes, sizeof(bits));
+    if (bits == 0 || bits == ~0ULL) {
+        return false;
+    }
+
+    //Strings, random code is hardly ever all printable
+    bool text = true;
+    for (size_t i = 0; i < TILEGX_BUNDLE_SIZE && text; ++i) {
+        text = bytes[i] == 0 || bytes[i] == '\t' || bytes[i] == '\n' || bytes[i] == '\r' ||
+               (bytes[i] >= 0x20 && bytes[i] < 0x7f);
+    }
+    if (text) {
+        return false;
+    }
+
+    TilegxBundle bundle;
+    return tilegx_build_bundle_opcodes(bits, bundle);
+}
+
+void build_likely_code(TilegxFlowMap& map, const TilegxSnapshot& snapshot)
+{
+    size_t num_bundles = (map.end_ea - map.start_ea) / TILEGX_BUNDLE_SIZE;
+    std::vector< bool > plausible(num_bundles);
+    for (size_t i = 0; i < num_bundles; ++i) {
+        plausible[i] = plausible_bundle(snapshot, i);
+    }
+
+    //Sliding count over [i - LIKELY_CODE_WINDOW, i + LIKELY_CODE_WINDOW],
+    //cut at the segment bounds
+    map.likely_code.assign((num_bundles + 63) / 64, 0);
+    size_t count = 0;
+    for (size_t i = 0; i < std::min(LIKELY_CODE_WINDOW, num_bundles); ++i) {
+        count += plausible[i];
+    }
+    for (size_t i = 0; i < num_bundles; ++i) {
+        if (i + LIKELY_CODE_WINDOW < num_bundles) {
+            count += plausible[i + LIKELY_CODE_WINDOW];
+        }
+        if (i > LIKELY_CODE_WINDOW) {
+            count -= plausible[i - LIKELY_CODE_WINDOW - 1];
+        }
+
+        size_t first = i > LIKELY_CODE_WINDOW ? i - LIKELY_CODE_WINDOW : 0;
+        size_t last = std::min(i + LIKELY_CODE_WINDOW + 1, num_bundles);
+        if (plausible[i] && count * 100 >= (last - first) * LIKELY_CODE_PERCENT) {
+            map.likely_code[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+} //namespace
+
+void tilegx_scan_bundles(const uint8_t* bytes, size_t num_bundles, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS])
+{
+    tilegx_scan_bundles_with(tilegx_scan_best_kernel(), bytes, num_bundles, bitmaps);
+}
+
+TilegxScanKernel tilegx_scan_best_kernel()
+{
+#ifdef TILEGX_SCAN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return TILEGX_SCAN_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return TILEGX_SCAN_KERNEL_SSE41;
+    }
+#endif
+    return TILEGX_SCAN_KERNEL_SCALAR;
+}
+
+bool tilegx_scan_bundles_with(TilegxScanKernel kernel, const uint8_t* bytes, size_t num_bundles, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS])
+{
+    if (kernel > tilegx_scan_best_kernel()) {
+        return false;
+    }
+
+    const TilegxScanTable& table = scan_table();
+    for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+        memset(bitmaps[kind], 0, (num_bundles + 63) / 64 * sizeof(uint64_t));
+    }
+
+    //The vector kernels leave the last few bundles to the scalar one
+    size_t done = 0;
+#ifdef TILEGX_SCAN_X86
+    if (kernel == TILEGX_SCAN_KERNEL_AVX2) {
+        done = scan_avx2(table, bytes, num_bundles, bitmaps);
+    }
+    else if (kernel == TILEGX_SCAN_KERNEL_SSE41) {
+        done = scan_sse41(table, bytes, num_bundles, bitmaps);
+    }
+#endif
+    scan_scalar(table, bytes, done, num_bundles, bitmaps);
+    return true;
+}
+
+unsigned tilegx_flow_kinds(ea_t bundle_ea)
+{
+    TilegxFlowMap* map = find_map(bundle_ea);
+    if (map == nullptr) {
+        return ~0u;
+    }
+
+    size_t idx = (bundle_ea - map->start_ea) / TILEGX_BUNDLE_SIZE;
+    unsigned kinds = 0;
+    for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+        if (map->bitmaps[kind][idx / 64] & (1ULL << (idx % 64))) {
+            kinds |= 1 << kind;
+        }
+    }
+    return kinds;
+}
+
+bool tilegx_likely_code(ea_t bundle_ea)
+{
+    TilegxFlowMap* map = find_map(bundle_ea);
+    if (map == nullptr) {
+        return false;
+    }
+
+    //The snapshot lives as long as the map
+    if (map->likely_code.empty()) {
+        build_likely_code(*map, *tilegx_snapshot(bundle_ea));
+    }
+
+    size_t idx = (bundle_ea - map->start_ea) / TILEGX_BUNDLE_SIZE;
+    return (map->likely_code[idx / 64] >> (idx % 64)) & 1;
+}
+
+void tilegx_flow_invalidate(ea_t start_ea, ea_t end_ea)
+{
+    TilegxFlowState& state = flow_state();
+    state.last_map = nullptr;
+    state.maps.erase(std::remove_if(state.maps.begin(), state.maps.end(),
+        [start_ea, end_ea](const std::unique_ptr< TilegxFlowMap >& map) {
+            return map->start_ea < end_ea && map->end_ea > start_ea;
+        }), state.maps.end());
+}
@@ -0,0 +1,92 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+#ifndef _TILEGX_SCAN_HPP
+#define _TILEGX_SCAN_HPP
+
+#include <idp.hpp>
+
+/**
+ * Control flow bundles are found without decoding, by matching the bundle
+ * words against the fixed bits of the control flow instructions, several
+ * words at a time with AVX2 or SSE4.1 where the CPU has them. The result is
+ * one bitmap per kind and segment, built when the segment is first asked
+ * about.
+ *
+ * A set bit means that the fixed bits of an instruction of that kind match,
+ * the bundle still has to be decoded to get the operands. A bundle without
+ * any bit set has no slot with CF_CALL, CF_JUMP or CF_STOP, which emu uses
+ * to skip decoding the other slots of the bundle.
+ */
+enum TilegxScanKind
+{
+    TILEGX_SCAN_BRANCH,   //Conditional branches and j
+    TILEGX_SCAN_CALL,     //jal, jalr, jalrp
+    TILEGX_SCAN_INDIRECT, //jr, jrp
+    TILEGX_SCAN_SWINT,    //swint0 to swint3
+    TILEGX_SCAN_STOP,     //iret, raise and the other instructions that stop
+    TILEGX_NUM_SCAN_KINDS
+};
+
+/**
+ * Implementations of tilegx_scan_bundles, which all give the same bitmaps
+ */
+enum TilegxScanKernel
+{
+    TILEGX_SCAN_KERNEL_SCALAR,
+    TILEGX_SCAN_KERNEL_SSE41,
+    TILEGX_SCAN_KERNEL_AVX2
+};
+
+/**
+ * Classify num_bundles little endian bundle words. Sets bit i % 64 of
+ * bitmaps[kind][i / 64] for every bundle i of that kind and clears the other
+ * bits. The bitmaps hold (num_bundles + 63) / 64 words.
+ */
+void tilegx_scan_bundles(const uint8_t* bytes, size_t num_bundles, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS]);
+
+/**
+ * @return Fastest kernel the CPU has, the one tilegx_scan_bundles uses
+ */
+TilegxScanKernel tilegx_scan_best_kernel();
+
+/**
+ * tilegx_scan_bundles with a given kernel, for the benchmark (scanbench.cpp)
+ *
+ * @return false if the CPU or the build does not have the kernel
+ */
+bool tilegx_scan_bundles_with(TilegxScanKernel kernel, const uint8_t* bytes, size_t num_bundles, uint64_t* const bitmaps[TILEGX_NUM_SCAN_KINDS]);
+
+/**
+ * @return Bit (1 << kind) for every TilegxScanKind of the bundle at
+ *         bundle_ea, or ~0 if the bundle is not in a segment
+ */
+unsigned tilegx_flow_kinds(ea_t bundle_ea);
+
+/**
+ * Whether the bundle at bundle_ea looks like code. A bundle does if it
+ * decodes, is neither zero nor all ones, is not printable text, and most of
+ * the bundles around it (LIKELY_CODE_WINDOW) do as well. The bitmap for the
+ * segment is built on the first call.
+ */
+bool tilegx_likely_code(ea_t bundle_ea);
+
+/**
+ * Drop the bitmaps of the segments that overlap [start_ea, end_ea)
+ */
+void tilegx_flow_invalidate(ea_t start_ea, ea_t end_ea);
+
+#endif /* _TILEGX_SCAN_HPP */
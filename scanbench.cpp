@@ -0,0 +1,127 @@
+/**
+  * Copyright 2019 Cisco
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *    http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+
+/**
+ * Benchmark of the control flow scan (scan.cpp). Classifies a synthetic
+ * segment with every kernel the CPU has, on one thread, checks that they
+ * agree with the scalar one, and prints the throughput.
+ *
+ * The segment is random bundle words with a control flow instruction in one
+ * bundle of 16, which is about what code has. The kernels do the same work
+ * for any data, only the scalar one skips the Y mode groups for X bundles.
+ *
+ * Usage: scanbench [MB]
+ */
+
+//Our own imports
+#include "scan.hpp"
+#include "dec.hpp"
+
+//stdlib imports
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const char* const KERNEL_NAMES[] = { "scalar", "sse4.1", "avx2" };
+
+//Best of this many runs
+static const unsigned RUNS = 5;
+
+static void make_segment(std::vector< uint8_t >& bytes)
+{
+    //Encodings of j, jal, jr and beqz in X1 to mix in
+    std::vector< std::pair< uint64_t, uint64_t > > flows;
+    for (TilegxOpcode opcode : { TILEGX_OPC_J, TILEGX_OPC_JAL, TILEGX_OPC_JR, TILEGX_OPC_BEQZ }) {
+        uint64_t mask;
+        uint64_t value;
+        if (tilegx_opcode_encoding(opcode, TILEGX_PIPELINE_X1, mask, value)) {
+            flows.emplace_back(mask | (3ULL << 62), value);
+        }
+    }
+
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < bytes.size() / TILEGX_BUNDLE_SIZE; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        uint64_t word = state;
+        if (i % 16 == 0 && !flows.empty()) {
+            const std::pair< uint64_t, uint64_t >& flow = flows[(i / 16) % flows.size()];
+            word = (word & ~flow.first) | flow.second;
+        }
+        memcpy(&bytes[i * TILEGX_BUNDLE_SIZE], &word, sizeof(word));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t mb = argc > 1 ? strtoul(argv[1], nullptr, 0) : 64;
+    std::vector< uint8_t > bytes(mb * 1024 * 1024);
+    size_t num_bundles = bytes.size() / TILEGX_BUNDLE_SIZE;
+    make_segment(bytes);
+
+    std::vector< uint64_t > reference[TILEGX_NUM_SCAN_KINDS];
+    std::vector< uint64_t > result[TILEGX_NUM_SCAN_KINDS];
+    uint64_t* reference_bitmaps[TILEGX_NUM_SCAN_KINDS];
+    uint64_t* result_bitmaps[TILEGX_NUM_SCAN_KINDS];
+    for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+        reference[kind].resize((num_bundles + 63) / 64);
+        result[kind].resize((num_bundles + 63) / 64);
+        reference_bitmaps[kind] = reference[kind].data();
+        result_bitmaps[kind] = result[kind].data();
+    }
+    tilegx_scan_bundles_with(TILEGX_SCAN_KERNEL_SCALAR, bytes.data(), num_bundles, reference_bitmaps);
+
+    size_t found = 0;
+    for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+        for (uint64_t word : reference[kind]) {
+            found += __builtin_popcountll(word);
+        }
+    }
+    printf("segment: %zu MB, %zu bundles, %zu control flow matches\n", mb, num_bundles, found);
+
+    int status = 0;
+    for (unsigned kernel = TILEGX_SCAN_KERNEL_SCALAR; kernel <= TILEGX_SCAN_KERNEL_AVX2; ++kernel) {
+        double best = 0;
+        bool supported = true;
+        for (unsigned run = 0; run < RUNS && supported; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            supported = tilegx_scan_bundles_with(static_cast<TilegxScanKernel>(kernel), bytes.data(), num_bundles, result_bitmaps);
+            std::chrono::duration< double > seconds = std::chrono::steady_clock::now() - start;
+            if (run == 0 || seconds.count() < best) {
+                best = seconds.count();
+            }
+        }
+
+        if (!supported) {
+            printf("%-7s not supported\n", KERNEL_NAMES[kernel]);
+            continue;
+        }
+
+        bool same = true;
+        for (unsigned kind = 0; kind < TILEGX_NUM_SCAN_KINDS; ++kind) {
+            same &= result[kind] == reference[kind];
+        }
+        if (!same) {
+            status = 1;
+        }
+        printf("%-7s %6.2f GB/s %s\n", KERNEL_NAMES[kernel], bytes.size() / best / 1e9, same ? "" : "(differs from scalar)");
+    }
+    return status;
+}